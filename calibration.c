@@ -0,0 +1,130 @@
+/*	gc_n64_usb : Gamecube or N64 controller to USB firmware
+	Copyright (C) 2007-2021  Raphael Assenat <raph@raphnet.net>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <string.h>
+#include <avr/pgmspace.h>
+#include "calibration.h"
+#include "eeprom.h"
+
+/* The response is computed for each value, with 16 bit arithmetic. Only
+ * the reciprocal of the input span (deadzone to outer) of each group is
+ * kept, to avoid a division per axis. */
+static uint8_t enabled; // bit per group
+static uint16_t span_recip[CALIB_NUM_GROUPS]; // 65535 / span
+
+static const uint8_t full_scale[CALIB_NUM_GROUPS] PROGMEM = { 80, 100, 100, 255 };
+
+static uint8_t getSpan(const struct calib_params *p, uint8_t full)
+{
+	uint8_t outer = p->outer ? p->outer : full;
+
+	return outer > p->deadzone ? outer - p->deadzone : 1;
+}
+
+void calibration_build(void)
+{
+	const struct calib_params *p;
+	uint8_t i;
+
+	enabled = 0;
+	for (i=0; i<CALIB_NUM_GROUPS; i++) {
+		p = &g_eeprom_data.ext.calib[i];
+		if (p->center[0] || p->center[1] || p->deadzone || p->anti_deadzone || p->outer || p->curve) {
+			enabled |= 1<<i;
+		}
+		span_recip[i] = 0xffff / getSpan(p, pgm_read_byte(&full_scale[i]));
+	}
+}
+
+/* Output for a magnitude m past the deadzone */
+static uint8_t response(uint8_t group, uint8_t m)
+{
+	const struct calib_params *p = &g_eeprom_data.ext.calib[group];
+	uint8_t full = pgm_read_byte(&full_scale[group]);
+	uint8_t adz = p->anti_deadzone;
+	uint16_t u, y;
+	int16_t v;
+
+	if (m >= getSpan(p, full))
+		return full;
+	if (adz > full)
+		adz = full;
+
+	/* v = u - k.u.(1-u), with u = m / span and k = curve / 128. u and v
+	 * are in 1/256 units and stay in 0..255. */
+	u = ((uint32_t)m * span_recip[group] + 128) >> 8;
+	v = u - ((int16_t)p->curve * (int16_t)((u * (256 - u)) >> 8)) / 128;
+
+	y = adz + (((full - adz) * (uint16_t)v + 128) >> 8);
+
+	return y > full ? full : y;
+}
+
+static int8_t stickAxis(uint8_t group, int8_t value, uint8_t axis)
+{
+	const struct calib_params *p = &g_eeprom_data.ext.calib[group];
+	int16_t m = value - p->center[axis];
+	uint8_t out;
+
+	if (m < 0) {
+		m = -m;
+	}
+	if (m <= p->deadzone)
+		return 0;
+	m -= p->deadzone;
+	if (m > 127)
+		m = 127;
+
+	out = response(group, m);
+
+	return (value < p->center[axis]) ? -out : out;
+}
+
+static uint8_t trigger(uint8_t value, uint8_t axis)
+{
+	const struct calib_params *p = &g_eeprom_data.ext.calib[CALIB_GC_TRIGGERS];
+	int16_t m = value - (uint8_t)p->center[axis];
+
+	if (m <= p->deadzone)
+		return 0;
+	m -= p->deadzone;
+
+	return response(CALIB_GC_TRIGGERS, m);
+}
+
+void calibration_applyN64(n64_pad_data *n64)
+{
+	if (enabled & (1<<CALIB_N64_STICK)) {
+		n64->x = stickAxis(CALIB_N64_STICK, n64->x, 0);
+		n64->y = stickAxis(CALIB_N64_STICK, n64->y, 1);
+	}
+}
+
+void calibration_applyGC(gc_pad_data *gc)
+{
+	if (enabled & (1<<CALIB_GC_MAIN)) {
+		gc->x = stickAxis(CALIB_GC_MAIN, gc->x, 0);
+		gc->y = stickAxis(CALIB_GC_MAIN, gc->y, 1);
+	}
+	if (enabled & (1<<CALIB_GC_CSTICK)) {
+		gc->cx = stickAxis(CALIB_GC_CSTICK, gc->cx, 0);
+		gc->cy = stickAxis(CALIB_GC_CSTICK, gc->cy, 1);
+	}
+	if (enabled & (1<<CALIB_GC_TRIGGERS)) {
+		gc->lt = trigger(gc->lt, 0);
+		gc->rt = trigger(gc->rt, 1);
+	}
+}
@@ -0,0 +1,45 @@
+#ifndef _calibration_h__
+#define _calibration_h__
+
+#include <stdint.h>
+#include "gamepads.h"
+
+/* Analog calibration. Each group (a stick, or the two triggers) has its
+ * own parameters and response table. The center is per axis.
+ *
+ * For each axis, the distance from the center (the magnitude) goes
+ * through the response:
+ *
+ * - Up to the deadzone, the output is 0.
+ * - Past the deadzone, the output starts at anti_deadzone and reaches
+ *   full scale when the magnitude is outer. It saturates there.
+ * - In between, curve bends the response. 0 is linear, positive values
+ *   make it gentler near the center, negative values more sensitive.
+ *
+ * Full scale is the official range of the controller: 80 for the N64
+ * stick, 100 for Gamecube sticks and 255 for the triggers. Magnitudes
+ * and anti_deadzone use the units of the raw values.
+ */
+#define CALIB_N64_STICK		0
+#define CALIB_GC_MAIN		1
+#define CALIB_GC_CSTICK		2
+#define CALIB_GC_TRIGGERS	3 // center[0]: L, center[1]: R (rest position)
+#define CALIB_NUM_GROUPS	4
+
+struct calib_params {
+	int8_t center[2]; // X and Y
+	uint8_t deadzone;
+	uint8_t anti_deadzone;
+	uint8_t outer; // 0: full scale
+	int8_t curve; // -127 ... 127
+};
+#define CALIB_PARAMS_SIZE	6
+
+/* Rebuild the response tables from the configuration */
+void calibration_build(void);
+
+/* Apply the calibration (if any) to the analog values, in place. */
+void calibration_applyN64(n64_pad_data *n64);
+void calibration_applyGC(gc_pad_data *gc);
+
+#endif // _calibration_h__
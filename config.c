@@ -66,6 +66,10 @@ uint8_t config_getSupportedParams(uint8_t *dst)
 	for (i=0; i<NUM_CHANNELS; i++) {
 		dst[n++] = CFG_PARAM_POLL_INTERVAL0 + i;
 	}
+	dst[n++] = CFG_PARAM_POLL_SOF_LEAD;
+	for (i=0; i<CALIB_NUM_GROUPS; i++) {
+		dst[n++] = CFG_PARAM_CALIB_N64_STICK + i;
+	}
 	for (i=0; paramsAndFlags[i].flag; i++) {
 		dst[n++] = paramsAndFlags[i].param;
 	}
@@ -103,6 +107,16 @@ unsigned char config_getParam(unsigned char param, unsigned char *value, unsigne
 			*value = g_eeprom_data.cfg.poll_interval[3];
 			return 1;
 #endif
+		case CFG_PARAM_POLL_SOF_LEAD:
+			value[0] = g_eeprom_data.ext.poll_sof_lead;
+			value[1] = g_eeprom_data.ext.poll_sof_lead >> 8;
+			return 2;
+		case CFG_PARAM_CALIB_N64_STICK:
+		case CFG_PARAM_CALIB_GC_MAIN:
+		case CFG_PARAM_CALIB_GC_CSTICK:
+		case CFG_PARAM_CALIB_GC_TRIGGERS:
+			memcpy(value, &g_eeprom_data.ext.calib[param - CFG_PARAM_CALIB_N64_STICK], CALIB_PARAMS_SIZE);
+			return CALIB_PARAMS_SIZE;
 
 		default:
 			for (i=0; paramsAndFlags[i].flag; i++) {
@@ -149,6 +163,15 @@ unsigned char config_setParam(unsigned char param, const unsigned char *value)
 			g_eeprom_data.cfg.poll_interval[3] = value[0];
 			break;
 #endif
+		case CFG_PARAM_POLL_SOF_LEAD:
+			g_eeprom_data.ext.poll_sof_lead = value[0] | (value[1] << 8);
+			break;
+		case CFG_PARAM_CALIB_N64_STICK:
+		case CFG_PARAM_CALIB_GC_MAIN:
+		case CFG_PARAM_CALIB_GC_CSTICK:
+		case CFG_PARAM_CALIB_GC_TRIGGERS:
+			memcpy(&g_eeprom_data.ext.calib[param - CFG_PARAM_CALIB_N64_STICK], value, CALIB_PARAMS_SIZE);
+			break;
 
 		default:
 			for (i=0; paramsAndFlags[i].flag; i++) {
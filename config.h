@@ -1,6 +1,9 @@
 #ifndef _config_h__
 #define _config_h__
 
+#include <stdint.h>
+#include "calibration.h"
+
 #define NUM_CHANNELS	4
 #define SERIAL_NUM_LEN	6
 struct eeprom_cfg {
@@ -10,6 +13,15 @@ struct eeprom_cfg {
 	uint32_t flags;
 };
 
+/* Settings added since. They are stored after the block above, with
+ * their own length and CRC, so that updating the firmware does not reset
+ * the settings. Only add fields at the end. New fields read as 0 when
+ * coming from an older firmware. */
+struct eeprom_cfg_ext {
+	uint16_t poll_sof_lead; // in microseconds. 0 = not synchronized to USB frames
+	struct calib_params calib[CALIB_NUM_GROUPS]; // CFG_PARAM_CALIB_*
+};
+
 #define FLAG_GC_FULL_SLIDERS			0x01
 #define FLAG_GC_INVERT_TRIGS			0x02
 #define FLAG_GC_SLIDERS_AS_BUTTONS		0x04
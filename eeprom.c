@@ -20,22 +20,33 @@
 #include <string.h>
 #include "eeprom.h"
 
-static uint16_t calc_geeprom_data_crc(void)
+static uint16_t calc_crc(const uint8_t *data, uint8_t len)
 {
 	uint16_t crc = 0x0000;
 	int i;
 
-	/* Update the CRC */
-	for (i=0; i<EEPROM_USED_SIZE_NOCRC; i++) {
-		crc = _crc_xmodem_update(crc, ((uint8_t*)&g_eeprom_data)[i]);
+	for (i=0; i<len; i++) {
+		crc = _crc_xmodem_update(crc, data[i]);
 	}
 
 	return crc;
 }
 
+static uint16_t calc_geeprom_data_crc(void)
+{
+	return calc_crc((uint8_t*)&g_eeprom_data, EEPROM_USED_SIZE_NOCRC);
+}
+
+static uint16_t calc_ext_crc(void)
+{
+	return calc_crc((uint8_t*)&g_eeprom_data.ext, g_eeprom_data.ext_len);
+}
+
 void eeprom_commit(void)
 {
 	g_eeprom_data.crc16 = calc_geeprom_data_crc();
+	g_eeprom_data.ext_len = EEPROM_EXT_LEN;
+	g_eeprom_data.ext_crc16 = calc_ext_crc();
 
 	/* Sync eeprom content */
 	eeprom_update_block(&g_eeprom_data, EEPROM_BASE_PTR, EEPROM_USED_SIZE);
@@ -63,6 +74,23 @@ void eeprom_init(void)
 		// Write the now valid content to the EEPROM at once.
 		eeprom_commit();
 	}
+	else if (g_eeprom_data.ext_len != EEPROM_EXT_LEN)
+	{
+		/* Written by another firmware version. Keep what is valid
+		 * and known, the rest defaults to 0. */
+		if (g_eeprom_data.ext_len > EEPROM_EXT_LEN ||
+				g_eeprom_data.ext_crc16 != calc_ext_crc()) {
+			g_eeprom_data.ext_len = 0;
+		}
+		memset((uint8_t*)&g_eeprom_data.ext + g_eeprom_data.ext_len, 0,
+				EEPROM_EXT_LEN - g_eeprom_data.ext_len);
+		eeprom_commit();
+	}
+	else if (g_eeprom_data.ext_crc16 != calc_ext_crc())
+	{
+		memset(&g_eeprom_data.ext, 0, EEPROM_EXT_LEN);
+		eeprom_commit();
+	}
 
 	eeprom_app_ready();
 }
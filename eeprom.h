@@ -2,11 +2,13 @@
 #define _eeprom_h__
 
 #include <stdint.h>
+#include <stddef.h>
 
 #define EEPROM_MAGIC	0xfeed
 #define EEPROM_BASE_PTR	((void*)0x0000)
 #define EEPROM_USED_SIZE	(sizeof(struct eeprom_data_struct))
-#define EEPROM_USED_SIZE_NOCRC	(EEPROM_USED_SIZE-2)
+#define EEPROM_USED_SIZE_NOCRC	(offsetof(struct eeprom_data_struct, crc16))
+#define EEPROM_EXT_LEN		(sizeof(struct eeprom_cfg_ext))
 
 #include "config.h" // config.h to struct eeprom_cfg
 
@@ -14,6 +16,12 @@ struct eeprom_data_struct {
 	uint16_t magic;
 	struct eeprom_cfg cfg;
 	uint16_t crc16;
+
+	/* Extension block. ext_len is the size of the ext structure of the
+	 * firmware which wrote it. ext_crc16 covers that many bytes. */
+	uint8_t ext_len;
+	uint16_t ext_crc16;
+	struct eeprom_cfg_ext ext;
 };
 
 extern struct eeprom_data_struct g_eeprom_data;
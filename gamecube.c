@@ -21,6 +21,7 @@
 #include "gamepads.h"
 #include "gamecube.h"
 #include "gcn64_protocol.h"
+#include "hiddata.h"
 
 /*********** prototypes *************/
 static void gamecubeInit(unsigned char chn);
@@ -36,8 +37,17 @@ static unsigned char orig_y[GAMEPAD_MAX_CHANNELS];
 static unsigned char orig_cx[GAMEPAD_MAX_CHANNELS];
 static unsigned char orig_cy[GAMEPAD_MAX_CHANNELS];
 
+/* When channels 0 and 1 are both to be polled with the same command,
+ * they are polled at once by the first update() call. The second
+ * channel then finds its reply waiting. */
+static unsigned char batch_mask; // prepared channels
+static unsigned char batch_done; // channels with a reply in batch_data
+static unsigned char batch_count[2];
+static unsigned char batch_data[2][GC_GETSTATUS_REPLY_LENGTH];
+
 static void gamecubeInit(unsigned char chn)
 {
+	batch_done &= ~(1<<chn);
 	gamecubeUpdate(chn);
 }
 
@@ -122,6 +132,14 @@ void gc_decodeAnswer(unsigned char chn, unsigned char data[8])
 	}
 }
 
+/* count is what gcn64_transaction() returned */
+static void countShortReply(unsigned char chn, unsigned char count)
+{
+	if (count && count < GC_GETSTATUS_REPLY_LENGTH) {
+		gcn64_countEvent(chn, GCN64_EVENT_SHORT_REPLY);
+	}
+}
+
 static char gamecubeUpdateKB(unsigned char chn)
 {
 	unsigned char tmpdata[GC_GETSTATUS_REPLY_LENGTH];
@@ -134,6 +152,7 @@ static char gamecubeUpdateKB(unsigned char chn)
 
 	count = gcn64_transaction(chn, tmpdata, 3, tmpdata, GC_GETSTATUS_REPLY_LENGTH);
 	if (count != GC_GETSTATUS_REPLY_LENGTH) {
+		countShortReply(chn, count);
 		return 1;
 	}
 
@@ -143,6 +162,7 @@ static char gamecubeUpdateKB(unsigned char chn)
 	}
 
 	if (tmpdata[7] != lrc) {
+		gcn64_countEvent(chn, GCN64_EVENT_LRC_ERROR);
 		return 1; // LRC error
 	}
 
@@ -155,17 +175,74 @@ static char gamecubeUpdateKB(unsigned char chn)
 	return 0;
 }
 
+static void gamecubePrepare(unsigned char chn)
+{
+	batch_done &= ~(1<<chn);
+	if (chn < 2) {
+		batch_mask |= 1<<chn;
+	}
+}
+
+static void gamecubeUpdateBatch(void)
+{
+	unsigned char tmpdata[3];
+	unsigned char *rx[2] = { batch_data[0], batch_data[1] };
+	unsigned char *samples;
+	char res;
+
+	if (batch_mask != 0x03 || gc_rumbling[0] != gc_rumbling[1]) {
+		// Only one channel, or different commands.
+		batch_mask = 0;
+		return;
+	}
+
+	/* The samples go in the management interface buffers. While they
+	 * are in use, each channel is polled on its own. */
+	samples = hiddata_borrowScratch();
+	if (!samples) {
+		batch_mask = 0;
+		return;
+	}
+
+	tmpdata[0] = GC_GETSTATUS1;
+	tmpdata[1] = GC_GETSTATUS2;
+	tmpdata[2] = GC_GETSTATUS3(gc_rumbling[0]);
+
+	res = gcn64_transactionMulti(batch_mask, tmpdata, 3, rx, GC_GETSTATUS_REPLY_LENGTH, batch_count,
+									samples, HIDDATA_SCRATCH_SIZE);
+	// Overwritten by a request before decoding ended: poll again one by one.
+	if (hiddata_releaseScratch() && res == 0) {
+		batch_done = batch_mask;
+	}
+	batch_mask = 0;
+}
+
 static char gamecubeUpdate(unsigned char chn)
 {
 	unsigned char tmpdata[GC_GETSTATUS_REPLY_LENGTH];
 	unsigned char count;
 
+	if (batch_mask & (1<<chn)) {
+		gamecubeUpdateBatch();
+	}
+
+	if (batch_done & (1<<chn)) {
+		batch_done &= ~(1<<chn);
+		if (batch_count[chn] != GC_GETSTATUS_REPLY_LENGTH) {
+			countShortReply(chn, batch_count[chn]);
+			return 1;
+		}
+		gc_decodeAnswer(chn, batch_data[chn]);
+		return 0;
+	}
+
 	tmpdata[0] = GC_GETSTATUS1;
 	tmpdata[1] = GC_GETSTATUS2;
 	tmpdata[2] = GC_GETSTATUS3(gc_rumbling[chn]);
 
 	count = gcn64_transaction(chn, tmpdata, 3, tmpdata, GC_GETSTATUS_REPLY_LENGTH);
 	if (count != GC_GETSTATUS_REPLY_LENGTH) {
+		countShortReply(chn, count);
 		return 1;
 	}
 
@@ -183,6 +260,7 @@ static void gamecubeHotplug(unsigned char chn)
 static char gamecubeProbe(unsigned char chn)
 {
 	origins_set[chn] = 0;
+	batch_done &= ~(1<<chn);
 
 	if (gamecubeUpdate(chn)) {
 		return 0;
@@ -200,6 +278,8 @@ static void gamecubeGetReport(unsigned char chn, gamepad_data *dst)
 {
 	if (dst)
 		memcpy(dst, &last_built_report[chn], sizeof(gamepad_data));
+
+	memcpy(&last_sent_report[chn], &last_built_report[chn], sizeof(gamepad_data));
 }
 
 static void gamecubeVibration(unsigned char chn, char enable)
@@ -209,6 +289,7 @@ static void gamecubeVibration(unsigned char chn, char enable)
 
 Gamepad GamecubeGamepad = {
 	.init					= gamecubeInit,
+	.prepare				= gamecubePrepare,
 	.update					= gamecubeUpdate,
 	.changed				= gamecubeChanged,
 	.getReport				= gamecubeGetReport,
@@ -85,8 +85,15 @@ typedef struct _gamepad_data {
 } gamepad_data;
 
 #define GAMEPAD_MAX_CHANNELS	2
+#define GAMEPAD_UPDATE_PENDING	2
 typedef struct {
 	void (*init)(unsigned char chn);
+	/* Optional. When present, called on all channels to be polled before
+	 * update() is called on them. For commands that must be followed by a
+	 * pause, so the pause can be shared between channels. */
+	void (*prepare)(unsigned char chn);
+	/* Returns 0 on success, GAMEPAD_UPDATE_PENDING when waiting on
+	 * something (call again later), other values on error. */
 	char (*update)(unsigned char chn);
 	char (*changed)(unsigned char chn);
 	void (*hotplug)(unsigned char chn);
@@ -22,6 +22,9 @@
 
 #include "gcn64_protocol.h"
 #include "gcn64txrx.h"
+#include "intervaltimer.h"
+#include "sitrace.h"
+#include "log.h"
 
 #undef FORCE_KEYBOARD
 #undef TRACE_GCN64
@@ -49,6 +52,68 @@
 
 #define DISABLE_INTS_DURING_COMM
 
+/* this delay is required on N64 controllers. Otherwise, after sending
+ * a rumble-on or rumble-off command (probably init too), the following
+ * get status fails. This starts to work at 30us. 60us should be safe.
+ *
+ * It is only needed between two transactions on the same channel, so it
+ * is enforced before the next one instead of after each one. (+1 since
+ * the timer reading may be up to a tick late) */
+#define INTER_TRANSACTION_TICKS	(INTERVALTIMER_US_TO_TICKS(80) + 1)
+
+static uint16_t last_transaction[4]; // Timer1 value at end of reception
+static uint8_t gap_pending; // bit per channel
+static struct gcn64_health health[4];
+
+void gcn64_countEvent(unsigned char chn, unsigned char event)
+{
+	uint16_t *counter;
+
+	if (chn > 3 || event >= GCN64_NUM_EVENTS)
+		return;
+
+	counter = &health[chn].events[event];
+	if (*counter != 0xffff) {
+		(*counter)++;
+	}
+}
+
+unsigned char gcn64_getHealth(unsigned char chn, unsigned char *dst, unsigned char clear)
+{
+	struct gcn64_health *h;
+	unsigned char i, n = 0;
+
+	if (chn > 3)
+		return 0;
+
+	h = &health[chn];
+	dst[n++] = h->transactions;
+	dst[n++] = h->transactions >> 8;
+	dst[n++] = h->transactions >> 16;
+	dst[n++] = h->transactions >> 24;
+	for (i=0; i<GCN64_NUM_EVENTS; i++) {
+		dst[n++] = h->events[i];
+		dst[n++] = h->events[i] >> 8;
+	}
+
+	if (clear) {
+		memset(h, 0, sizeof(struct gcn64_health));
+	}
+
+	return n;
+}
+
+static void countTransaction(unsigned char chn, unsigned char count)
+{
+	health[chn].transactions++;
+
+	switch (count)
+	{
+		case 0: gcn64_countEvent(chn, GCN64_EVENT_NO_REPLY); break;
+		case 0xff: gcn64_countEvent(chn, GCN64_EVENT_FRAME_ERROR); break;
+	}
+}
+
 void gcn64protocol_hwinit(void)
 {
 	// data as input
@@ -63,6 +128,25 @@ void gcn64protocol_hwinit(void)
 	PORTB &= ~0x10;
 }
 
+/* Polls and probes are answered within a few microseconds. For those, the
+ * receiver gives up after 32us so empty ports are skipped quickly. Other
+ * commands (expansion bus accesses, raw commands from the host..) keep
+ * the longer wait. */
+static char quickReply(unsigned char cmd)
+{
+	switch (cmd)
+	{
+		case N64_GET_CAPABILITIES: // Also GC_GETID
+		case N64_RESET:
+		case N64_GET_STATUS:
+		case GC_GETSTATUS1:
+		case GC_POLL_KB1:
+			return 1;
+	}
+
+	return 0;
+}
+
 /**
  * \brief Send n data bytes + stop bit, wait for answer.
  *
@@ -70,7 +154,7 @@ void gcn64protocol_hwinit(void)
  * \param tx Data to be transmitted
  * \param tx_len Transmission length
  * \param rx Reception buffer
- * \param rx_max Buffer size
+ * \param rx_max Buffer size. Reception stops once this many bytes are in.
  * \return The number of bytes received, 0 on timeout/error.
  */
 unsigned char gcn64_transaction(unsigned char chn, const unsigned char *tx, int tx_len, unsigned char *rx, unsigned char rx_max)
@@ -90,6 +174,16 @@ unsigned char gcn64_transaction(unsigned char chn, const unsigned char *tx, int
 		default: return 0;
 	}
 
+	if (tx_len < 1 || !quickReply(tx[0])) {
+		switch(chn)
+		{
+			case 0: receiveBytes = gcn64_receiveBytesLong0; break;
+			case 1: receiveBytes = gcn64_receiveBytesLong1; break;
+			case 2: receiveBytes = gcn64_receiveBytesLong2; break;
+			case 3: receiveBytes = gcn64_receiveBytesLong3; break;
+		}
+	}
+
 #ifdef TRACE_GCN64
 	int i;
 
@@ -100,6 +194,13 @@ unsigned char gcn64_transaction(unsigned char chn, const unsigned char *tx, int
 	printf("}\r\n");
 #endif
 
+	if (gap_pending & (1<<chn)) {
+		while ((uint16_t)(intervaltimer_now() - last_transaction[chn]) < INTER_TRANSACTION_TICKS) {
+			_delay_us(4);
+		}
+		gap_pending &= ~(1<<chn);
+	}
+
 #ifdef DISABLE_INTS_DURING_COMM
 	cli();
 #endif
@@ -107,6 +208,9 @@ unsigned char gcn64_transaction(unsigned char chn, const unsigned char *tx, int
 	count = receiveBytes(rx, rx_max);
 	SREG = sreg;
 
+	sitrace_record(chn, tx, tx_len, rx, count);
+	countTransaction(chn, count);
+
 	if (count == 0xff) {
 #ifdef TRACE_GCN64
 		printf("rx error\r\n");
@@ -129,14 +233,134 @@ unsigned char gcn64_transaction(unsigned char chn, const unsigned char *tx, int
 	printf("}\r\n");
 #endif
 
-	/* this delay is required on N64 controllers. Otherwise, after sending
-	 * a rumble-on or rumble-off command (probably init too), the following
-	 * get status fails. This starts to work at 30us. 60us should be safe. */
-	_delay_us(80); // Note that this results in a ~100us delay between packets.
+	last_transaction[chn] = intervaltimer_now();
+	gap_pending |= 1<<chn;
+
+	return count;
+}
+
+/* Parallel transactions on channels 0 and 1. Samples are 0.625us apart,
+ * 4 per byte. Like the single channel receiver, a bit is a 1 when its low
+ * period is shorter than its high period, whatever the bit rate. */
+/* Port bits of channels 0 and 1, as wired in the Makefile (GCN64_DATA_BIT
+ * above only lists the bits, channel 1 is on bit 2). */
+#define MULTI_PORT_BIT0			(1<<0)
+#define MULTI_PORT_BIT1			(1<<2)
+/* Fallback when the samples end before the next bit starts: halfway
+ * between the 1us (1.6 samples) and 3us (4.8 samples) low periods. */
+#define MULTI_SHORT_LOW			3
+/* Sample bytes for a reply of n bytes: 4us bits with a 10% margin for slow
+ * controllers, plus 16us for a channel starting later than the other. */
+#define MULTI_SAMPLE_BYTES(n)	((((n) * 8 + 1) * 44 / 10 + 16) * 2 / 5)
+
+static unsigned char multiSample(const unsigned char *samples, unsigned char chn, uint16_t s)
+{
+	return samples[s >> 2] & (1 << (((s & 3) << 1) + chn));
+}
+
+static unsigned char decodeSamples(const unsigned char *samples, unsigned char chn, unsigned char n_sample_bytes, unsigned char *dst, unsigned char n_bytes)
+{
+	uint16_t s = 0, total = n_sample_bytes * 4, low, high;
+	unsigned char bit, bits = 0, byte = 0, count = 0;
+
+	// Skip the idle line until the first bit
+	while (s < total && multiSample(samples, chn, s)) {
+		s++;
+	}
+
+	while (count < n_bytes) {
+		for (low = 0; s < total && !multiSample(samples, chn, s); s++) {
+			low++;
+		}
+		if (s >= total) {
+			break;
+		}
+		for (high = 0; s < total && multiSample(samples, chn, s); s++) {
+			high++;
+		}
+
+		if (s < total) {
+			bit = low < high;
+		} else {
+			bit = low <= MULTI_SHORT_LOW;
+		}
+
+		byte = (byte << 1) | bit;
+		if (++bits == 8) {
+			dst[count++] = byte;
+			bits = 0;
+		}
+	}
 
 	return count;
 }
 
+/**
+ * \brief Send the same command on channels 0 and 1 at once and receive both replies.
+ * \param chn_mask Channels (bit per channel, 0x03 for both)
+ * \param tx Data to send
+ * \param tx_len Transmission length
+ * \param rx Reception buffers, one per channel
+ * \param rx_len Expected reply length
+ * \param counts Number of bytes received on each channel
+ * \param samples Buffer for the samples, only used during the call
+ * \param samples_size Buffer size (MULTI_SAMPLE_BYTES(rx_len) are needed)
+ * \return 0 on success, -1 if the reply is too long to be sampled.
+ */
+char gcn64_transactionMulti(unsigned char chn_mask, const unsigned char *tx, int tx_len, unsigned char *rx[2], unsigned char rx_len, unsigned char counts[2], unsigned char *samples, unsigned char samples_size)
+{
+	unsigned char sreg = SREG;
+	unsigned char port_bits = 0, n_sample_bytes, chn;
+	uint16_t now;
+
+	if (MULTI_SAMPLE_BYTES(rx_len) > samples_size) {
+		return -1;
+	}
+	n_sample_bytes = MULTI_SAMPLE_BYTES(rx_len);
+
+	chn_mask &= 0x03;
+	if (chn_mask & 1)
+		port_bits |= MULTI_PORT_BIT0;
+	if (chn_mask & 2)
+		port_bits |= MULTI_PORT_BIT1;
+
+	for (chn=0; chn<2; chn++) {
+		if ((chn_mask & gap_pending) & (1<<chn)) {
+			while ((uint16_t)(intervaltimer_now() - last_transaction[chn]) < INTER_TRANSACTION_TICKS) {
+				_delay_us(4);
+			}
+		}
+	}
+
+#ifdef DISABLE_INTS_DURING_COMM
+	cli();
+#endif
+	gcn64_sendBytesMulti(tx, tx_len, port_bits);
+	n_sample_bytes = gcn64_sampleMulti(samples, n_sample_bytes, port_bits);
+	SREG = sreg;
+
+	now = intervaltimer_now();
+	for (chn=0; chn<2; chn++) {
+		counts[chn] = 0;
+		if (!(chn_mask & (1<<chn))) {
+			continue;
+		}
+		counts[chn] = decodeSamples(samples, chn, n_sample_bytes, rx[chn], rx_len);
+		last_transaction[chn] = now;
+		sitrace_record(chn, tx, tx_len, rx[chn], counts[chn]);
+		countTransaction(chn, counts[chn]);
+	}
+	gap_pending |= chn_mask;
+
+	return 0;
+}
+
+/** \brief Timer1 value (intervaltimer_now()) at the end of the last transaction on a channel */
+uint16_t gcn64_lastTransactionTime(unsigned char chn)
+{
+	return last_transaction[chn & 3];
+}
+
 
 #if (GC_GETID != 	N64_GET_CAPABILITIES)
 #error N64 vs GC detection commnad broken
@@ -211,7 +435,7 @@ int gcn64_detectController(unsigned char chn)
 
 	id = (data[0]<<8) | data[1];
 
-	printf("Id: %04x   (%d: %02x %02x %02x)\r\n", id, count, data[0], data[1], data[2]);
+	log_event(LOG_SI_ID, id, count, data[0], data[1], data[2]);
 
 #ifdef FORCE_KEYBOARD
 	return CONTROLLER_IS_GC_KEYBOARD;
@@ -168,5 +168,32 @@ void gcn64protocol_hwinit(void);
 #define GCN64_CHANNEL_3			3
 int gcn64_detectController(unsigned char chn);
 unsigned char gcn64_transaction(unsigned char chn, const unsigned char *tx, int tx_len, unsigned char *rx, unsigned char rx_max);
+/* Worst case bus time of a transaction: 4us per bit, plus the gap after
+ * the previous transaction, the stop bits, the reply delay and margin. */
+#define GCN64_TRANSACTION_US(tx_len, rx_len)	(((tx_len) + (rx_len)) * 32 + 120)
+uint16_t gcn64_lastTransactionTime(unsigned char chn);
+/* Bus health counters, per channel. Transactions, no replies and frame
+ * errors are counted by gcn64_transaction(). The others are reported by
+ * the drivers and main loop with gcn64_countEvent(). Over-long replies
+ * are not detected: reception stops once rx_max bytes are in. */
+#define GCN64_EVENT_NO_REPLY		0 // Nothing received
+#define GCN64_EVENT_FRAME_ERROR		1 // Partial byte (0xff)
+#define GCN64_EVENT_SHORT_REPLY		2 // Fewer bytes than the command returns
+#define GCN64_EVENT_LRC_ERROR		3 // Keyboard reply checksum
+#define GCN64_EVENT_DETECTED		4 // Controller found on an empty port
+#define GCN64_EVENT_DISCONNECTED	5 // Controller dropped after read errors
+#define GCN64_NUM_EVENTS			6
+
+struct gcn64_health {
+	uint32_t transactions;
+	uint16_t events[GCN64_NUM_EVENTS]; // Saturate at 0xffff
+};
+
+void gcn64_countEvent(unsigned char chn, unsigned char event);
+/* Copy the counters of a channel (little endian, transactions first)
+ * to dst and optionally clear them. Returns the number of bytes. */
+unsigned char gcn64_getHealth(unsigned char chn, unsigned char *dst, unsigned char clear);
+
+char gcn64_transactionMulti(unsigned char chn_mask, const unsigned char *tx, int tx_len, unsigned char *rx[2], unsigned char rx_len, unsigned char counts[2], unsigned char *samples, unsigned char samples_size);
 
 #endif // _gcn64_protocol_h__
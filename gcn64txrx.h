@@ -9,12 +9,35 @@ void gcn64_sendBytes3(const unsigned char *data, unsigned char n_bytes);
 /**
  * \brief Receive up to \max_bytes bytes
  * \param dstbuf Destination buffer
- * \param max_bytes The maximum number of bytes
- * \return The number of received bytes. 0xFF in case of error, 0xFE in case of overflow (max_bytes too small)
+ * \param max_bytes The maximum number of bytes. Returns as soon as they are received,
+ *                  without waiting for the end of the reply.
+ * \return The number of received bytes. 0xFF in case of error, 0xFE if something answered and max_bytes is 0
  */
 unsigned char gcn64_receiveBytes0(unsigned char *dstbuf, unsigned char max_bytes);
 unsigned char gcn64_receiveBytes1(unsigned char *dstbuf, unsigned char max_bytes);
 unsigned char gcn64_receiveBytes2(unsigned char *dstbuf, unsigned char max_bytes);
 unsigned char gcn64_receiveBytes3(unsigned char *dstbuf, unsigned char max_bytes);
 
+/**
+ * \brief Same as gcn64_receiveBytes, but wait about 80us instead of 32us for the reply to start
+ */
+unsigned char gcn64_receiveBytesLong0(unsigned char *dstbuf, unsigned char max_bytes);
+unsigned char gcn64_receiveBytesLong1(unsigned char *dstbuf, unsigned char max_bytes);
+unsigned char gcn64_receiveBytesLong2(unsigned char *dstbuf, unsigned char max_bytes);
+unsigned char gcn64_receiveBytesLong3(unsigned char *dstbuf, unsigned char max_bytes);
+
+/**
+ * \brief Send to all the port bits in mask at once (gcn64txrx_multi.S)
+ */
+void gcn64_sendBytesMulti(const unsigned char *data, unsigned char n_bytes, unsigned char mask);
+
+/**
+ * \brief Wait for a reply on any of the port bits in mask, then sample channels 0 and 1
+ * \param dstbuf Sample buffer, 4 samples of both channels per byte
+ * \param n_bytes Buffer size
+ * \param mask Port bits to watch for the start of a reply
+ * \return n_bytes, or 0 if nothing answered.
+ */
+unsigned char gcn64_sampleMulti(unsigned char *dstbuf, unsigned char n_bytes, unsigned char mask);
+
 #endif // _gcn64txrx_h__
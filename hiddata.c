@@ -16,6 +16,7 @@
 */
 #include <stdio.h>
 #include <string.h>
+#include <avr/interrupt.h>
 #include "requests.h"
 #include "config.h"
 #include "hiddata.h"
@@ -24,6 +25,11 @@
 #include "gcn64_protocol.h"
 #include "version.h"
 #include "main.h"
+#include "latency.h"
+#include "sitrace.h"
+#include "n64pak.h"
+#include "tpak.h"
+#include "usart1.h"
 
 // dataHidReport is 63 bytes. Endpoint is 64 bytes.
 #define CMDBUF_SIZE 64
@@ -31,22 +37,76 @@
 #define STATE_IDLE			0
 #define STATE_NEW_COMMAND	1	// New command in buffer
 #define STATE_COMMAND_DONE	2	// Result in buffer
+#define STATE_BLOCK_IO		3	// Block IO in progress, result not ready
+#define STATE_PAK_READ		4	// Pak read stream in progress, block not ready
+#define STATE_PAK_WRITE		5	// Pak write answer not ready
+#define STATE_TPAK_POWER	6	// Transfer pak power sequence in progress
 
 //#define DEBUG
 
 extern char g_polling_suspended;
 
 static volatile uint8_t state = STATE_IDLE;
-static unsigned char cmdbuf[CMDBUF_SIZE];
 static volatile unsigned char cmdbuf_len = 0;
 
+/* The command buffer and the job buffer, next to each other so they can
+ * be lent as one scratch buffer (see hiddata_borrowScratch()). */
+static unsigned char hidbuf[CMDBUF_SIZE * 2];
+#define cmdbuf	(hidbuf)
+#define jobbuf	(hidbuf + CMDBUF_SIZE)
+static volatile uint8_t scratch_lent;
+static volatile uint8_t scratch_clobbered;
+
+/* Requests answered in several parts (block IO, pak reads) continue in
+ * resume_state once an answer has been read by the host. */
+static volatile uint8_t resume_state = STATE_IDLE;
+static volatile uint8_t answer_read; // Set when resuming
+
+/* Block IO runs one transaction per hiddata_doTask() call, when the main
+ * loop is not polling. When the results do not fit in one answer, the
+ * answer ends with BLOCKIO_MORE and the remaining transactions run once
+ * it has been read. */
+#define BLOCKIO_MORE		0xfe // Never a valid record header (n_rx <= 61)
+static uint8_t blockio_pos; // Next entry in jobbuf
+static uint8_t blockio_out; // Next record in cmdbuf
+
+/* Pak reads are streamed, one block per answer. The next block is read
+ * while the host fetches the current one. Pak writes are pipelined: the
+ * block is written while the host sends the next one, which waits in the
+ * second half of jobbuf. Transfer pak requests use the same answers, with
+ * Game Boy addresses. Like block IO, one transaction runs per
+ * hiddata_doTask() call, Transfer pak bank selects included. */
+#define PAK_RETRIES			2
+#define PAK_ANSWER_SIZE		(5 + N64PAK_BLOCK_SIZE)
+#define PAK_READ_US			GCN64_TRANSACTION_US(3, N64PAK_BLOCK_SIZE + 1)
+#define PAK_WRITE_US		GCN64_TRANSACTION_US(3 + N64PAK_BLOCK_SIZE, 1)
+#define PAK_STATUS_NONE		0xff // No write to report
+static uint8_t pak_rq; // Request being answered
+static uint8_t pak_chn;
+static uint16_t pak_addr; // Next block (read) or block being written
+static uint16_t pak_blocks; // Blocks left to answer
+static uint8_t pak_status;
+static uint8_t pak_retries;
+static uint8_t pak_ready; // jobbuf holds block pak_addr
+static uint16_t pak_next_addr; // Queued write
+static uint8_t pak_wr_blocks; // Writes in jobbuf (0 to 2)
+static uint8_t pak_wr_wait; // Writes to complete before answering
+static uint8_t pak_done_status = PAK_STATUS_NONE; // Last write not reported yet
+static uint16_t pak_done_addr;
+static uint8_t pak_power_on;
+static uint8_t pak_step; // Transfer pak power sequence
+
 /*** Get/Set report called from interrupt context! */
 uint16_t hiddata_get_report(void *ctx, struct usb_request *rq, const uint8_t **dat)
 {
 //	printf("Get data\n");
 	if (state == STATE_COMMAND_DONE) {
 		*dat = cmdbuf;
-		state = STATE_IDLE;
+		state = resume_state;
+		if (resume_state != STATE_IDLE) {
+			resume_state = STATE_IDLE;
+			answer_read = 1;
+		}
 #ifdef DEBUG
 		printf_P(PSTR("hiddata idle, sent %d bytes\r\n"), cmdbuf_len);
 #endif
@@ -67,56 +127,304 @@ uint8_t hiddata_set_report(void *ctx, const struct usb_request *rq, const uint8_
 	printf_P(PSTR("\r\n"));
 #endif
 
+	// A pak write not queued yet would be lost. Stall, the host may retry.
+	if (state == STATE_NEW_COMMAND && (cmdbuf[0] == RQ_GCN64_PAK_WRITE || cmdbuf[0] == RQ_GCN64_TPAK_WRITE)) {
+		return 1;
+	}
+
+	if (scratch_lent) {
+		scratch_clobbered = 1;
+	}
 	state = STATE_NEW_COMMAND;
+	resume_state = STATE_IDLE;
 	memcpy(cmdbuf, dat, len);
 	cmdbuf_len = len;
 
 	return 0;
 }
 
-static uint8_t processBlockIO(void)
+static void blockIOStartAnswer(void)
 {
-	uint8_t requestCopy[CMDBUF_SIZE];
-	int i, rx_offset = 0, rx;
-	uint8_t chn, n_tx, n_rx;
-
-	memcpy(requestCopy, cmdbuf, CMDBUF_SIZE);
 	memset(cmdbuf + 1, 0xff, CMDBUF_SIZE-1);
+	blockio_out = 1;
+}
 
-	for (rx_offset = 1, i=1; i<CMDBUF_SIZE; ) {
-		if (i + 3 >= CMDBUF_SIZE)
-			break;
+static void startBlockIO(void)
+{
+	// CMD: RQ, { CHN, N_TX, N_RX, tx[N_TX] }..., 0xff
+	// Answer: RQ, { N_RX | flags, rx[N_RX] }..., 0xff padding (63 bytes)
+	memcpy(jobbuf, cmdbuf, CMDBUF_SIZE);
+	blockio_pos = 1;
+	blockIOStartAnswer();
+	state = STATE_BLOCK_IO;
+}
 
-		chn = requestCopy[i];
-		if (chn == 0xff)
-			break;
-		i++;
-		n_tx = requestCopy[i];
-		i++;
-		n_rx = requestCopy[i];
-		i++;
-		if (n_tx == 0)
-			continue;
-
-		if (rx_offset + 1 + n_rx >= CMDBUF_SIZE) {
-			break;
+/* Unless a new command replaced the request meanwhile (interrupt context) */
+static void blockIOAnswer(uint8_t more)
+{
+	uint8_t sreg = SREG;
+
+	cli();
+	if (state == STATE_BLOCK_IO) {
+		if (more) {
+			cmdbuf[blockio_out] = BLOCKIO_MORE;
 		}
+		cmdbuf_len = 63;
+		resume_state = more ? STATE_BLOCK_IO : STATE_IDLE;
+		state = STATE_COMMAND_DONE;
+	}
+	SREG = sreg;
+}
+
+static void blockIOStep(struct hiddata_ops *ops)
+{
+	uint8_t rxbuf[CMDBUF_SIZE];
+	uint8_t chn, n_tx, n_rx, rx, sreg;
+	uint8_t *entry = jobbuf + blockio_pos;
+
+	if (answer_read) {
+		sreg = SREG;
+		cli();
+		answer_read = 0;
+		if (state == STATE_BLOCK_IO) {
+			blockIOStartAnswer();
+		}
+		SREG = sreg;
+	}
+
+	if (blockio_pos + 3 >= CMDBUF_SIZE || entry[0] == 0xff) {
+		blockIOAnswer(0);
+		return;
+	}
 
-		rx = gcn64_transaction(chn, requestCopy + i, n_tx, cmdbuf + rx_offset + 1, n_rx);
-		cmdbuf[rx_offset] = n_rx;
-		if (rx <= 0) {
+	chn = entry[0];
+	n_tx = entry[1];
+	n_rx = entry[2];
+	if (n_tx == 0) {
+		blockio_pos += 3;
+		return;
+	}
+
+	if (blockio_out + 1 + n_rx >= CMDBUF_SIZE) {
+		// Does not fit. Continue in the next answer, unless it never will.
+		blockIOAnswer(blockio_out > 1);
+		return;
+	}
+
+	if (ops && ops->busFree && !ops->busFree(GCN64_TRANSACTION_US(n_tx, n_rx))) {
+		return;
+	}
+
+	memset(rxbuf, 0xff, n_rx);
+	rx = gcn64_transaction(chn, entry + 3, n_tx, rxbuf, n_rx);
+	blockio_pos += 3 + n_tx;
+
+	// A new command may have replaced the request meanwhile.
+	sreg = SREG;
+	cli();
+	if (state == STATE_BLOCK_IO) {
+		cmdbuf[blockio_out] = n_rx;
+		if (rx == 0) {
 			// timeout
-			cmdbuf[rx_offset] |= 0x80;
+			cmdbuf[blockio_out] |= 0x80;
 		} else if (rx < n_rx) {
 			// less than expected
-			cmdbuf[rx_offset] |= 0x40;
+			cmdbuf[blockio_out] |= 0x40;
+		}
+		memcpy(cmdbuf + blockio_out + 1, rxbuf, n_rx);
+		blockio_out += n_rx + 1;
+	}
+	SREG = sreg;
+}
+
+/* One transaction for block pak_addr. Returns 1 when done (pak_status is
+ * set), after retries. Returns 0 when more calls are needed: the bus was
+ * not free, a retry is due or the Transfer pak bank was just selected. */
+static uint8_t pakTransaction(struct hiddata_ops *ops, uint8_t write, uint8_t *data)
+{
+	uint8_t tpak = pak_rq == RQ_GCN64_TPAK_READ || pak_rq == RQ_GCN64_TPAK_WRITE;
+	uint8_t bank = tpak && tpak_needBank(pak_chn, pak_addr);
+	uint8_t status;
+
+	if (ops && ops->busFree && !ops->busFree(bank || write ? PAK_WRITE_US : PAK_READ_US)) {
+		return 0;
+	}
+
+	if (bank) {
+		status = tpak_selectBank(pak_chn, pak_addr);
+		if (status == N64PAK_OK) {
+			return 0; // The access is next
+		}
+	} else if (tpak) {
+		status = write ? tpak_write(pak_chn, pak_addr, data) : tpak_read(pak_chn, pak_addr, data);
+	} else {
+		status = write ? n64pak_write(pak_chn, pak_addr, data) : n64pak_read(pak_chn, pak_addr, data);
+	}
+
+	if (status != N64PAK_OK && pak_retries) {
+		pak_retries--;
+		return 0;
+	}
+
+	pak_status = status;
+	pak_retries = PAK_RETRIES;
+
+	return 1;
+}
+
+static void startPakRead(void)
+{
+	// CMD: RQ, CHN, ADDR (16 bit, LSB first), N_BLOCKS (16 bit, LSB first)
+	// Answer (once per block): RQ, CHN, STATUS, ADDR (16 bit, LSB first), data[32]
+	pak_rq = cmdbuf[0];
+	pak_chn = cmdbuf[1];
+	pak_addr = cmdbuf[2] | cmdbuf[3] << 8;
+	pak_blocks = cmdbuf[4] | cmdbuf[5] << 8;
+	pak_retries = PAK_RETRIES;
+	pak_ready = 0;
+	state = pak_blocks ? STATE_PAK_READ : STATE_IDLE;
+}
+
+/* Called in STATE_PAK_READ, and while the previous block is being read by
+ * the host (prefetch). */
+static void pakReadStep(struct hiddata_ops *ops)
+{
+	uint8_t sreg;
+
+	if (!pak_ready) {
+		if (!pakTransaction(ops, 0, jobbuf)) {
+			return;
+		}
+		pak_ready = 1;
+	}
+
+	sreg = SREG;
+	cli();
+	if (state == STATE_PAK_READ) {
+		cmdbuf[0] = pak_rq;
+		cmdbuf[1] = pak_chn;
+		cmdbuf[2] = pak_status;
+		cmdbuf[3] = pak_addr;
+		cmdbuf[4] = pak_addr >> 8;
+		memcpy(cmdbuf + 5, jobbuf, N64PAK_BLOCK_SIZE);
+		cmdbuf_len = PAK_ANSWER_SIZE;
+		pak_addr += N64PAK_BLOCK_SIZE;
+		pak_blocks--;
+		pak_ready = 0;
+		resume_state = pak_blocks ? STATE_PAK_READ : STATE_IDLE;
+		state = STATE_COMMAND_DONE;
+	}
+	SREG = sreg;
+}
+
+/* Unless a new command replaced the request meanwhile (interrupt context) */
+static void pakWriteAnswer(void)
+{
+	uint8_t sreg = SREG;
+
+	cli();
+	if (state == STATE_PAK_WRITE && !pak_wr_wait) {
+		cmdbuf[2] = pak_done_status;
+		cmdbuf[3] = pak_done_addr;
+		cmdbuf[4] = pak_done_addr >> 8;
+		cmdbuf_len = 5;
+		pak_done_status = PAK_STATUS_NONE;
+		state = STATE_COMMAND_DONE;
+	}
+	SREG = sreg;
+}
+
+/* Returns 0 when the write cannot be queued yet */
+static uint8_t startPakWrite(void)
+{
+	// CMD: RQ, CHN, ADDR (16 bit, LSB first), data[32]
+	//  or: RQ, CHN (answered once all writes are done)
+	// Answer: RQ, CHN, STATUS, ADDR (16 bit, LSB first) of the previous write,
+	// once it is done. STATUS is 0xff when there is none. Send the next block
+	// after reading the answer, while this one is being written.
+	uint8_t has_data = cmdbuf_len >= 4 + N64PAK_BLOCK_SIZE;
+	uint16_t addr = cmdbuf[2] | cmdbuf[3] << 8;
+
+	if (has_data && pak_wr_blocks &&
+			(pak_wr_blocks == 2 || cmdbuf[0] != pak_rq || cmdbuf[1] != pak_chn)) {
+		return 0;
+	}
+
+	pak_wr_wait = pak_wr_blocks;
+	if (has_data) {
+		if (pak_wr_blocks) {
+			pak_next_addr = addr;
+		} else {
+			pak_rq = cmdbuf[0];
+			pak_chn = cmdbuf[1];
+			pak_addr = addr;
+			pak_retries = PAK_RETRIES;
 		}
-		rx_offset += n_rx + 1;
+		memcpy(jobbuf + pak_wr_blocks * N64PAK_BLOCK_SIZE, cmdbuf + 4, N64PAK_BLOCK_SIZE);
+		pak_wr_blocks++;
+	}
+
+	state = STATE_PAK_WRITE;
+	pakWriteAnswer();
+
+	return 1;
+}
+
+/* Called while writes are queued, whatever the state */
+static void pakWriteStep(struct hiddata_ops *ops)
+{
+	if (!pakTransaction(ops, 1, jobbuf)) {
+		return;
+	}
+
+	pak_done_status = pak_status;
+	pak_done_addr = pak_addr;
+	pak_wr_blocks--;
+	if (pak_wr_blocks) {
+		memcpy(jobbuf, jobbuf + N64PAK_BLOCK_SIZE, N64PAK_BLOCK_SIZE);
+		pak_addr = pak_next_addr;
+	}
+
+	if (pak_wr_wait) {
+		pak_wr_wait--;
+	}
+	pakWriteAnswer();
+}
+
+static void startTpakPower(void)
+{
+	// CMD : RQ, CHN, ON
+	// Answer: RQ, CHN, ON, STATUS, TPAK_STATUS
+	pak_chn = cmdbuf[1];
+	pak_power_on = cmdbuf[2];
+	pak_step = 0;
+	state = STATE_TPAK_POWER;
+}
+
+static void tpakPowerStep(struct hiddata_ops *ops)
+{
+	uint8_t res, sreg;
+	uint8_t tpak_status = 0;
 
-		i += n_tx;
+	if (ops && ops->busFree && !ops->busFree(pak_step < TPAK_POWER_STEPS - 1 ? PAK_WRITE_US : PAK_READ_US)) {
+		return;
 	}
 
-	return 63;
+	res = tpak_powerStep(pak_chn, pak_power_on, pak_step, &tpak_status);
+	pak_step++;
+	if (res == N64PAK_OK && pak_step < TPAK_POWER_STEPS) {
+		return;
+	}
+
+	sreg = SREG;
+	cli();
+	if (state == STATE_TPAK_POWER) {
+		cmdbuf[3] = res;
+		cmdbuf[4] = tpak_status;
+		cmdbuf_len = 5;
+		state = STATE_COMMAND_DONE;
+	}
+	SREG = sreg;
 }
 
 static void hiddata_processCommandBuffer(struct hiddata_ops *ops)
@@ -131,6 +439,11 @@ static void hiddata_processCommandBuffer(struct hiddata_ops *ops)
 		return;
 	}
 
+	// Queued pak writes use the bus and jobbuf. Other requests wait.
+	if (pak_wr_blocks && cmdbuf[0] != RQ_GCN64_PAK_WRITE && cmdbuf[0] != RQ_GCN64_TPAK_WRITE) {
+		return;
+	}
+
 //	printf("Process cmd 0x%02x\r\n", cmdbuf[0]);
 	switch(cmdbuf[0])
 	{
@@ -163,6 +476,7 @@ static void hiddata_processCommandBuffer(struct hiddata_ops *ops)
 		case RQ_GCN64_SET_CONFIG_PARAM:
 			// Cmd: RQ, PARAM, data[]
 			config_setParam(cmdbuf[1], cmdbuf+2);
+			usbpad_applyConfig();
 			// Answer: RQ, PARAM
 			cmdbuf_len = 2;
 			break;
@@ -200,7 +514,72 @@ static void hiddata_processCommandBuffer(struct hiddata_ops *ops)
 			cmdbuf_len = 3;
 			break;
 		case RQ_GCN64_BLOCK_IO:
-			cmdbuf_len = processBlockIO();
+			startBlockIO();
+			return; // Answered by blockIOStep()
+		case RQ_GCN64_PAK_READ:
+		case RQ_GCN64_TPAK_READ:
+			channel = cmdbuf[1];
+			if (channel >= NUM_CHANNELS || cmdbuf_len < 6)
+				break;
+			startPakRead();
+			return; // Answered by pakReadStep()
+		case RQ_GCN64_PAK_WRITE:
+		case RQ_GCN64_TPAK_WRITE:
+			channel = cmdbuf[1];
+			if (channel >= NUM_CHANNELS || cmdbuf_len < 2)
+				break;
+			startPakWrite();
+			return; // Retried until queued, answered by pakWriteStep()
+		case RQ_GCN64_TPAK_POWER:
+			channel = cmdbuf[1];
+			if (channel >= NUM_CHANNELS)
+				break;
+			startTpakPower();
+			return; // Answered by tpakPowerStep()
+		case RQ_GCN64_GET_LATENCY_HISTOGRAM:
+			// CMD : RQ, STAGE
+			// Answer: RQ, STAGE, N_BINS, counts[] (16 bit, LSB first)
+			cmdbuf[2] = latency_getHistogram(cmdbuf[1], cmdbuf + 3) / 2;
+			cmdbuf_len = 3 + cmdbuf[2] * 2;
+			break;
+		case RQ_GCN64_RESET_LATENCY:
+			// CMD : RQ, CHANNEL_MASK (0 for all)
+			// Answer: RQ, CHANNEL_MASK
+			latency_reset(cmdbuf[1]);
+			cmdbuf_len = 2;
+			break;
+#ifdef SITRACE
+		case RQ_GCN64_READ_SI_TRACE:
+			// CMD : RQ
+			// Answer: RQ, LEN, DROPPED (16 bit, LSB first), data[LEN]
+			// Records may span several answers. LEN is 0 when the trace is empty.
+			cmdbuf[2] = sitrace_dropped();
+			cmdbuf[3] = sitrace_dropped() >> 8;
+			cmdbuf[1] = sitrace_read(cmdbuf + 4, 63 - 4);
+			cmdbuf_len = 4 + cmdbuf[1];
+			break;
+		case RQ_GCN64_SET_SI_TRACE:
+			// CMD : RQ, ENABLE (clears the trace in all cases)
+			// Answer: RQ, ENABLE
+			sitrace_enable(cmdbuf[1]);
+			cmdbuf_len = 2;
+			break;
+#endif
+		case RQ_GCN64_GET_SI_HEALTH:
+			// CMD : RQ, CHN, CLEAR
+			// Answer: RQ, CHN, counters[] (see struct gcn64_health, LSB first)
+			channel = cmdbuf[1];
+			if (channel >= NUM_CHANNELS)
+				break;
+			cmdbuf_len = 2 + gcn64_getHealth(channel, cmdbuf + 2, cmdbuf[2]);
+			break;
+		case RQ_GCN64_GET_LOG_DROPPED:
+			// CMD : RQ
+			// Answer: RQ, DROPPED (16 bit, LSB first, saturates)
+			// Bytes of log/debug output dropped because the UART buffer was full.
+			cmdbuf[1] = usart1_getDropped();
+			cmdbuf[2] = usart1_getDropped() >> 8;
+			cmdbuf_len = 3;
 			break;
 		case RQ_RNT_GET_SUPPORTED_REQUESTS:
 			cmdbuf[1] = RQ_GCN64_JUMP_TO_BOOTLOADER;
@@ -216,7 +595,20 @@ static void hiddata_processCommandBuffer(struct hiddata_ops *ops)
 			cmdbuf[11] = RQ_RNT_GET_SUPPORTED_CFG_PARAMS;
 			cmdbuf[12] = RQ_RNT_GET_SUPPORTED_MODES;
 			cmdbuf[13] = RQ_RNT_GET_SUPPORTED_REQUESTS;
-			cmdbuf_len = 14;
+			cmdbuf[14] = RQ_GCN64_GET_LATENCY_HISTOGRAM;
+			cmdbuf[15] = RQ_GCN64_RESET_LATENCY;
+			cmdbuf[16] = RQ_GCN64_GET_SI_HEALTH;
+			cmdbuf[17] = RQ_GCN64_PAK_READ;
+			cmdbuf[18] = RQ_GCN64_PAK_WRITE;
+			cmdbuf[19] = RQ_GCN64_TPAK_POWER;
+			cmdbuf[20] = RQ_GCN64_TPAK_READ;
+			cmdbuf[21] = RQ_GCN64_TPAK_WRITE;
+			cmdbuf[22] = RQ_GCN64_GET_LOG_DROPPED;
+			cmdbuf_len = 23;
+#ifdef SITRACE
+			cmdbuf[cmdbuf_len++] = RQ_GCN64_READ_SI_TRACE;
+			cmdbuf[cmdbuf_len++] = RQ_GCN64_SET_SI_TRACE;
+#endif
 			break;
 		case RQ_RNT_GET_SUPPORTED_CFG_PARAMS:
 			cmdbuf_len = 1 + config_getSupportedParams(cmdbuf + 1);
@@ -241,8 +633,41 @@ static void hiddata_processCommandBuffer(struct hiddata_ops *ops)
 	state = STATE_COMMAND_DONE;
 }
 
+uint8_t *hiddata_borrowScratch(void)
+{
+	uint8_t *buf = NULL;
+	uint8_t sreg = SREG;
+
+	cli();
+	if (state == STATE_IDLE && !pak_wr_blocks) {
+		scratch_lent = 1;
+		scratch_clobbered = 0;
+		buf = hidbuf;
+	}
+	SREG = sreg;
+
+	return buf;
+}
+
+uint8_t hiddata_releaseScratch(void)
+{
+	uint8_t ok;
+	uint8_t sreg = SREG;
+
+	cli();
+	scratch_lent = 0;
+	ok = !scratch_clobbered;
+	SREG = sreg;
+
+	return ok;
+}
+
 void hiddata_doTask(struct hiddata_ops *ops)
 {
+	if (pak_wr_blocks) {
+		pakWriteStep(ops);
+	}
+
 	switch (state)
 	{
 		default:
@@ -255,6 +680,25 @@ void hiddata_doTask(struct hiddata_ops *ops)
 			break;
 
 		case STATE_COMMAND_DONE:
+			if (resume_state == STATE_PAK_READ) {
+				pakReadStep(ops);
+			}
+			break;
+
+		case STATE_BLOCK_IO:
+			blockIOStep(ops);
+			break;
+
+		case STATE_PAK_READ:
+			pakReadStep(ops);
+			break;
+
+		case STATE_PAK_WRITE:
+			// Answered by pakWriteStep()
+			break;
+
+		case STATE_TPAK_POWER:
+			tpakPowerStep(ops);
 			break;
 	}
 }
@@ -8,6 +8,9 @@ struct hiddata_ops {
 	void (*suspendPolling)(uint8_t suspend);
 	void (*forceVibration)(uint8_t channel, uint8_t force);
 	uint8_t (*getSupportedModes)(uint8_t *dst);
+	/* Optional. Background SI transactions (block IO, paks) only start
+	 * when this returns true for their worst case bus time. */
+	uint8_t (*busFree)(uint16_t us);
 };
 
 uint16_t hiddata_get_report(void *ctx, struct usb_request *rq, const uint8_t **dat);
@@ -15,4 +18,12 @@ uint8_t hiddata_set_report(void *ctx, const struct usb_request *rq, const uint8_
 
 void hiddata_doTask(struct hiddata_ops *ops);
 
+/* While no request is in progress, the command and job buffers can be
+ * lent to the main loop as scratch space. Returns NULL when busy. A
+ * request received meanwhile overwrites the buffer, hiddata_releaseScratch()
+ * then returns 0 and the content must be discarded. */
+#define HIDDATA_SCRATCH_SIZE	128
+uint8_t *hiddata_borrowScratch(void);
+uint8_t hiddata_releaseScratch(void);
+
 #endif
@@ -0,0 +1,10 @@
+#ifndef _host_avr_eeprom_h__
+#define _host_avr_eeprom_h__
+
+#include <stddef.h>
+
+/* Backed by a RAM array in host/hal.c, blank (0xff) at startup. */
+void eeprom_read_block(void *dst, const void *src, size_t n);
+void eeprom_update_block(const void *src, void *dst, size_t n);
+
+#endif // _host_avr_eeprom_h__
@@ -0,0 +1,13 @@
+#ifndef _host_avr_interrupt_h__
+#define _host_avr_interrupt_h__
+
+#include <avr/io.h>
+
+/* There are no interrupts on the host. The global interrupt flag is still
+ * kept in SREG so code saving/restoring it keeps working. */
+#define cli()	do { SREG &= ~(1<<SREG_I); } while (0)
+#define sei()	do { SREG |= (1<<SREG_I); } while (0)
+
+#define ISR(vector, ...)	void vector(void); void vector(void)
+
+#endif // _host_avr_interrupt_h__
@@ -0,0 +1,140 @@
+/*	gc_n64_usb : Gamecube or N64 controller to USB firmware
+	Copyright (C) 2007-2021  Raphael Assenat <raph@raphnet.net>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef _host_avr_io_h__
+#define _host_avr_io_h__
+
+/* Host build replacement for <avr/io.h>.
+ *
+ * The I/O space of the ATmega32u2 is backed by a plain RAM array (see
+ * host/hal.c). Registers live at the same data memory addresses as on
+ * the real chip, so code writing PORTD or testing a bit in PIND behaves
+ * like it would on the target, minus the hardware side effects. Modules
+ * that depend on other side effects (USB controller, SI bit-banging,
+ * compare match flags) are replaced by host/xxx_host.c files instead.
+ */
+
+#include <stdint.h>
+
+extern volatile uint8_t hal_sfr[0x100];
+
+/* Timer1 counts the virtual CPU clock. Reading TCNT1 brings it up to
+ * date, writes are picked up at the next access. */
+volatile uint16_t *hal_tcnt1(void);
+
+#define _SFR_MEM8(addr)		(hal_sfr[(addr)])
+#define _SFR_MEM16(addr)	(*(volatile uint16_t *)&hal_sfr[(addr)])
+#define _SFR_IO8(addr)		_SFR_MEM8((addr) + 0x20)
+#define _SFR_IO16(addr)		_SFR_MEM16((addr) + 0x20)
+#define _SFR_IO_ADDR(sfr)	((uint8_t)(&(sfr) - hal_sfr) - 0x20)
+#define _BV(bit)			(1 << (bit))
+
+/* Ports */
+#define PINB	_SFR_IO8(0x03)
+#define DDRB	_SFR_IO8(0x04)
+#define PORTB	_SFR_IO8(0x05)
+#define PINC	_SFR_IO8(0x06)
+#define DDRC	_SFR_IO8(0x07)
+#define PORTC	_SFR_IO8(0x08)
+#define PIND	_SFR_IO8(0x09)
+#define DDRD	_SFR_IO8(0x0A)
+#define PORTD	_SFR_IO8(0x0B)
+
+/* Interrupt flags */
+#define TIFR0	_SFR_IO8(0x15)
+#define TIFR1	_SFR_IO8(0x16)
+#define PCIFR	_SFR_IO8(0x1B)
+#define EIFR	_SFR_IO8(0x1C)
+#define EIMSK	_SFR_IO8(0x1D)
+#define GPIOR0	_SFR_IO8(0x1E)
+
+/* Timer 0 */
+#define TCCR0A	_SFR_IO8(0x24)
+#define TCCR0B	_SFR_IO8(0x25)
+#define TCNT0	_SFR_IO8(0x26)
+#define OCR0A	_SFR_IO8(0x27)
+#define OCR0B	_SFR_IO8(0x28)
+
+/* Core */
+#define SPL		_SFR_IO8(0x3D)
+#define SPH		_SFR_IO8(0x3E)
+#define SREG	_SFR_IO8(0x3F)
+#define CLKPR	_SFR_MEM8(0x61)
+#define PRR0	_SFR_MEM8(0x64)
+#define PRR1	_SFR_MEM8(0x65)
+#define PCICR	_SFR_MEM8(0x68)
+#define EICRA	_SFR_MEM8(0x69)
+#define PCMSK0	_SFR_MEM8(0x6B)
+#define TIMSK0	_SFR_MEM8(0x6E)
+#define TIMSK1	_SFR_MEM8(0x6F)
+
+/* Timer 1 */
+#define TCCR1A	_SFR_MEM8(0x80)
+#define TCCR1B	_SFR_MEM8(0x81)
+#define TCCR1C	_SFR_MEM8(0x82)
+#define TCNT1	(*hal_tcnt1())
+#define ICR1	_SFR_MEM16(0x86)
+#define OCR1A	_SFR_MEM16(0x88)
+#define OCR1B	_SFR_MEM16(0x8A)
+
+/* USART 1 */
+#define UCSR1A	_SFR_MEM8(0xC8)
+#define UCSR1B	_SFR_MEM8(0xC9)
+#define UCSR1C	_SFR_MEM8(0xCA)
+#define UCSR1D	_SFR_MEM8(0xCB)
+#define UBRR1L	_SFR_MEM8(0xCC)
+#define UBRR1H	_SFR_MEM8(0xCD)
+#define UDR1	_SFR_MEM8(0xCE)
+
+/* Bits */
+#define TOV0	0
+#define OCF0A	1
+#define OCF0B	2
+#define TOV1	0
+#define OCF1A	1
+#define OCF1B	2
+#define ICF1	5
+#define WGM00	0
+#define WGM01	1
+#define CS00	0
+#define CS01	1
+#define CS02	2
+#define WGM12	3
+#define WGM13	4
+#define CS10	0
+#define CS11	1
+#define CS12	2
+#define ICES1	6
+#define ICNC1	7
+#define TOIE1	0
+#define OCIE1A	1
+#define OCIE1B	2
+#define ICIE1	5
+#define OCIE0A	1
+#define UDRE1	5
+#define TXC1	6
+#define RXC1	7
+#define TXEN1	3
+#define RXEN1	4
+#define UDRIE1	5
+#define TXCIE1	6
+#define RXCIE1	7
+#define UCSZ10	1
+#define UCSZ11	2
+
+#define SREG_I	7
+
+#endif // _host_avr_io_h__
@@ -0,0 +1,27 @@
+#ifndef _host_avr_pgmspace_h__
+#define _host_avr_pgmspace_h__
+
+/* Flash and RAM share the same address space on the host. */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#define PROGMEM
+#define PSTR(s)		(s)
+#define PGM_P		const char *
+#define PGM_VOID_P	const void *
+
+#define pgm_read_byte(addr)		(*(const uint8_t *)(addr))
+#define pgm_read_word(addr)		(*(const uint16_t *)(addr))
+#define pgm_read_dword(addr)	(*(const uint32_t *)(addr))
+#define pgm_read_ptr(addr)		(*(void * const *)(addr))
+
+#define printf_P	printf
+#define sprintf_P	sprintf
+#define vfprintf_P	vfprintf
+#define strcpy_P	strcpy
+#define strlen_P	strlen
+#define memcpy_P	memcpy
+
+#endif // _host_avr_pgmspace_h__
@@ -0,0 +1,103 @@
+/*	gc_n64_usb : Gamecube or N64 controller to USB firmware
+	Copyright (C) 2007-2021  Raphael Assenat <raph@raphnet.net>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <avr/io.h>
+#include <avr/eeprom.h>
+#include "hal.h"
+
+#define EEPROM_SIZE	1024 // ATmega32u2
+
+volatile uint8_t hal_sfr[0x100] __attribute__((aligned(2)));
+static uint8_t eeprom[EEPROM_SIZE];
+static uint64_t cycles;
+static unsigned long loops;
+unsigned long hal_loop_limit;
+
+static void __attribute__((constructor)) hal_init(void)
+{
+	memset(eeprom, 0xff, sizeof(eeprom));
+}
+
+uint64_t hal_getCycles(void)
+{
+	return cycles;
+}
+
+void hal_advanceCycles(uint32_t n)
+{
+	cycles += n;
+}
+
+volatile uint16_t *hal_tcnt1(void)
+{
+	static const uint16_t prescalers[8] = { 0, 1, 8, 64, 256, 1024, 0, 0 };
+	static uint64_t base; // cycle count when TCNT1 was 0
+	static uint16_t last;
+	static uint8_t last_cs;
+	volatile uint16_t *reg = &_SFR_MEM16(0x84);
+	uint8_t cs = TCCR1B & 0x07;
+	uint16_t presc = prescalers[cs];
+
+	if (!presc) {
+		last_cs = cs;
+		return reg;
+	}
+
+	if (*reg != last || cs != last_cs) {
+		// Written by the firmware, or clock source changed.
+		base = cycles - (uint64_t)*reg * presc;
+		last_cs = cs;
+	}
+
+	*reg = last = (cycles - base) / presc;
+
+	return reg;
+}
+
+void hal_loopTick(void)
+{
+	cycles += HAL_IDLE_LOOP_CYCLES;
+	loops++;
+
+	if (hal_loop_limit && loops >= hal_loop_limit) {
+		hal_exit(0);
+	}
+}
+
+void eeprom_read_block(void *dst, const void *src, size_t n)
+{
+	uintptr_t addr = (uintptr_t)src;
+
+	if (addr + n > EEPROM_SIZE) {
+		fprintf(stderr, "eeprom read out of range\n");
+		abort();
+	}
+	memcpy(dst, eeprom + addr, n);
+}
+
+void eeprom_update_block(const void *src, void *dst, size_t n)
+{
+	uintptr_t addr = (uintptr_t)dst;
+
+	if (addr + n > EEPROM_SIZE) {
+		fprintf(stderr, "eeprom write out of range\n");
+		abort();
+	}
+	memcpy(eeprom + addr, src, n);
+}
@@ -0,0 +1,23 @@
+#ifndef _host_hal_h__
+#define _host_hal_h__
+
+#include <stdint.h>
+
+/* Virtual CPU clock, in F_CPU cycles. Only advances when the firmware
+ * burns time (delays, SI transfers, main loop iterations). */
+uint64_t hal_getCycles(void);
+void hal_advanceCycles(uint32_t cycles);
+
+/* Rough cost of one trip around the firmware main loop when it has
+ * nothing to do. Charged by usb_doTasks(). */
+#define HAL_IDLE_LOOP_CYCLES	200
+
+/* Main loop iterations before the host build stops. 0 = run forever. */
+extern unsigned long hal_loop_limit;
+
+/* Called once per main loop iteration (from usb_doTasks). Exits
+ * through hal_exit() when hal_loop_limit is reached. */
+void hal_loopTick(void);
+void hal_exit(int code);
+
+#endif // _host_hal_h__
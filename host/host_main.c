@@ -0,0 +1,186 @@
+/*	gc_n64_usb : Gamecube or N64 controller to USB firmware
+	Copyright (C) 2007-2021  Raphael Assenat <raph@raphnet.net>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <avr/io.h>
+#include "eeprom.h"
+#include "usbpad.h"
+#include "usb_host.h"
+#include "hal.h"
+#include "sisim.h"
+#include "gcn64_protocol.h"
+
+/* main() in main.c, renamed by Makefile.host */
+int firmware_main(void);
+
+static struct timespec t_start;
+
+static double elapsed_s(void)
+{
+	struct timespec t;
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return (t.tv_sec - t_start.tv_sec) + (t.tv_nsec - t_start.tv_nsec) / 1e9;
+}
+
+void hal_exit(int code)
+{
+	double real = elapsed_s();
+	double virt = hal_getCycles() / (double)F_CPU;
+	int i;
+
+	fflush(stdout);
+	fprintf(stderr, "[host] %.3f s virtual, %.3f s real (x%.1f)\n", virt, real, real > 0 ? virt / real : 0);
+	for (i=1; i<USB_HOST_NUM_EPS; i++) {
+		struct usb_host_ep *e = &usb_host_eps[i];
+		int b;
+
+		if (e->n_reports) {
+			fprintf(stderr, "[host] ep%d: %lu reports, last:", i, e->n_reports);
+			for (b=0; b<e->last_len; b++) {
+				fprintf(stderr, " %02x", e->last_report[b]);
+			}
+			fprintf(stderr, "\n");
+		}
+	}
+	sisim_printStats();
+	for (i=0; i<NUM_CHANNELS; i++) {
+		struct gcn64_health h;
+		int e;
+
+		gcn64_getHealth(i, (unsigned char*)&h, 0); // Little endian host
+		if (!h.transactions)
+			continue;
+		fprintf(stderr, "[host] chn %d health: %u transactions, events:", i, h.transactions);
+		for (e=0; e<GCN64_NUM_EVENTS; e++) {
+			fprintf(stderr, " %u", h.events[e]);
+		}
+		fprintf(stderr, "\n");
+	}
+
+	exit(code);
+}
+
+static void bench_usbpad(unsigned long n)
+{
+	struct usbpad pad;
+	gamepad_data data[2];
+	unsigned long i;
+	double t;
+
+	memset(data, 0, sizeof(data));
+	data[0].gc.pad_type = PAD_TYPE_GAMECUBE;
+	data[1].n64.pad_type = PAD_TYPE_N64;
+
+	usbpad_init(&pad, 0);
+	clock_gettime(CLOCK_MONOTONIC, &t_start);
+	for (i=0; i<n; i++) {
+		data[0].gc.x = i;
+		data[0].gc.cy = i >> 3;
+		data[0].gc.lt = i >> 1;
+		data[0].gc.buttons = i >> 4;
+		data[1].n64.x = i;
+		data[1].n64.buttons = i >> 4;
+		usbpad_update(&pad, &data[i & 1]);
+	}
+	t = elapsed_s();
+
+	printf("usbpad_update: %lu calls, %.1f ns/call\n", n, t * 1e9 / n);
+}
+
+static void usage(const char *prog)
+{
+	printf("Usage: %s [options]\n", prog);
+	printf("\n");
+	printf("Runs the firmware main loop against a host USB stand-in.\n");
+	printf("\n");
+	printf("  -n loops     Stop after this many main loop iterations (default 1000000, 0: never)\n");
+	printf("  -m mode      Adapter mode (CFG_MODE_*, e.g. 0x10 for dual port)\n");
+	printf("  -i ms[,ms..] Poll interval for all channels, or for each channel in turn\n");
+	printf("  -l us        Start polling this long before the USB frame (SOF lead, 0: off)\n");
+	printf("  -s           NSW mode (as if PORTD4 was high)\n");
+	printf("  -c chn:type[:from_ms[:to_ms]]\n");
+	printf("               Connect a simulated controller (repeat for each). Types:\n");
+	sisim_listTypes();
+	printf("  -u calls     Benchmark usbpad_update() instead and exit\n");
+	printf("  -h           Show help\n");
+}
+
+int main(int argc, char **argv)
+{
+	int opt, i;
+	int mode = -1, lead = -1;
+	int intervals[NUM_CHANNELS] = { }, n_intervals = 0;
+	char *p;
+	unsigned long bench = 0;
+
+	hal_loop_limit = 1000000;
+
+	while ((opt = getopt(argc, argv, "n:m:i:l:sc:u:h")) != -1) {
+		switch (opt)
+		{
+			case 'n': hal_loop_limit = strtoul(optarg, NULL, 0); break;
+			case 'm': mode = strtol(optarg, NULL, 0); break;
+			case 'i':
+				for (p = optarg, n_intervals = 0; *p && n_intervals < NUM_CHANNELS; ) {
+					intervals[n_intervals++] = strtol(p, &p, 0);
+					if (*p == ',') {
+						p++;
+					}
+				}
+				break;
+			case 'l': lead = strtol(optarg, NULL, 0); break;
+			case 's': PIND |= 0x10; break;
+			case 'c':
+				if (sisim_attach(optarg)) {
+					fprintf(stderr, "Bad controller spec: %s\n", optarg);
+					return 1;
+				}
+				break;
+			case 'u': bench = strtoul(optarg, NULL, 0); break;
+			case 'h': usage(argv[0]); return 0;
+			default: usage(argv[0]); return 1;
+		}
+	}
+
+	/* Settle the configuration through the real eeprom code. The
+	 * firmware reloads it from the (RAM-backed) eeprom at startup. */
+	eeprom_init();
+	if (mode >= 0) {
+		g_eeprom_data.cfg.mode = mode;
+	}
+	if (n_intervals) {
+		for (i=0; i<NUM_CHANNELS; i++) {
+			g_eeprom_data.cfg.poll_interval[i] = intervals[i < n_intervals ? i : n_intervals-1];
+		}
+	}
+	if (lead >= 0) {
+		g_eeprom_data.ext.poll_sof_lead = lead;
+	}
+	eeprom_commit();
+
+	if (bench) {
+		bench_usbpad(bench);
+		return 0;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &t_start);
+	return firmware_main();
+}
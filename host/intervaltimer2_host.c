@@ -0,0 +1,50 @@
+/*	gc_n64_usb : Gamecube or N64 controller to USB firmware
+	Copyright (C) 2007-2021  Raphael Assenat <raph@raphnet.net>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "intervaltimer2.h"
+#include "hal.h"
+
+/* Stand-in for intervaltimer2.c, clocked by the virtual CPU clock. The
+ * period is computed exactly like the CTC compare value programmed on
+ * the target (including the truncation). */
+
+static uint64_t start;
+static uint32_t period; // in cycles, 0 when stopped
+
+void intervaltimer2_init(void)
+{
+}
+
+void intervaltimer2_set16ms(void)
+{
+	start = hal_getCycles();
+	period = (16 * (F_CPU/1024) / 1000 + 1) * 1024UL;
+}
+
+char intervaltimer2_get(void)
+{
+	uint64_t elapsed;
+
+	if (!period)
+		return 0;
+
+	elapsed = hal_getCycles() - start;
+	if (elapsed < period)
+		return 0;
+
+	start += elapsed - (elapsed % period);
+	return 1;
+}
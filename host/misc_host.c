@@ -0,0 +1,61 @@
+/*	gc_n64_usb : Gamecube or N64 controller to USB firmware
+	Copyright (C) 2007-2021  Raphael Assenat <raph@raphnet.net>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <stdio.h>
+#include "usart1.h"
+#include "bootloader.h"
+#include "stkchk.h"
+#include "hal.h"
+
+/* Stand-ins for the small target-only modules. */
+
+/* usart1.c: printf already goes to the host stdout */
+void usart1_send(void *data, int len)
+{
+	fwrite(data, 1, len, stdout);
+}
+
+void usart1_init(void)
+{
+}
+
+uint16_t usart1_getDropped(void)
+{
+	return 0;
+}
+
+/* bootloader.c */
+void enterBootLoader(void)
+{
+	printf("[host] enterBootLoader\n");
+	hal_exit(0);
+}
+
+void resetFirmware(void)
+{
+	printf("[host] resetFirmware\n");
+	hal_exit(0);
+}
+
+/* stkchk.c: the host stack is not the target stack. */
+void stkchk_init(void)
+{
+}
+
+char stkchk_verify(void)
+{
+	return 0;
+}
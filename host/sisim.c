@@ -0,0 +1,323 @@
+/*	gc_n64_usb : Gamecube or N64 controller to USB firmware
+	Copyright (C) 2007-2021  Raphael Assenat <raph@raphnet.net>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sisim.h"
+#include "hal.h"
+#include "gcn64_protocol.h"
+
+#define DEV_N64			0
+#define DEV_GC			1
+#define DEV_GC_KB		2
+
+#define PAK_NONE		0
+#define PAK_RUMBLE		1
+#define PAK_MEMORY		2
+
+#define FLAG_BRAWLER	0x01 // Status reads as zeros too soon after get caps
+
+/* The brawler64 wants more than this between get caps and get status */
+#define BRAWLER_SETTLE_US	1000
+
+struct device_type {
+	const char *name;
+	const char *description;
+	uint8_t kind;
+	uint8_t id[3];
+	uint8_t pak;
+	uint8_t flags;
+	uint16_t latency_us;
+	uint8_t one_low_cycles; // Low time of a 1 bit. 0: nominal (1us)
+};
+
+static const struct device_type types[] = {
+	{ "n64", "N64 controller with rumble pak", DEV_N64, { 0x05, 0x00, 0x01 }, PAK_RUMBLE, 0, 2 },
+	{ "n64nopak", "N64 controller, nothing in the expansion port", DEV_N64, { 0x05, 0x00, 0x00 }, PAK_NONE, 0, 2 },
+	{ "n64cpak", "N64 controller with a 32KB controller pak", DEV_N64, { 0x05, 0x00, 0x01 }, PAK_MEMORY, 0, 2 },
+	{ "brawler64", "Brawler64 wireless (caps/status quirk)", DEV_N64, { 0x05, 0x00, 0x00 }, PAK_NONE, FLAG_BRAWLER, 10 },
+	{ "gc", "Gamecube controller", DEV_GC, { 0x09, 0x00, 0x20 }, PAK_NONE, 0, 3 },
+	{ "wavebird", "Wavebird receiver, controller on", DEV_GC, { 0xe9, 0xa0, 0x17 }, PAK_NONE, 0, 8 },
+	{ "gcslow", "Third party Gamecube controller, 1.5us low for a 1", DEV_GC, { 0x09, 0x00, 0x20 }, PAK_NONE, 0, 3, 24 },
+	{ "kb", "ASCII Gamecube keyboard", DEV_GC_KB, { 0x08, 0x20, 0x00 }, PAK_NONE, 0, 4 },
+};
+#define NUM_TYPES	(sizeof(types) / sizeof(types[0]))
+
+struct device {
+	const struct device_type *type;
+	uint32_t from_ms, to_ms;
+	uint64_t caps_cycles; // Last get caps
+	uint8_t rumbling;
+	uint8_t *pak_memory;
+};
+
+struct channel_stats {
+	unsigned long commands[256];
+	unsigned long replies;
+	unsigned long bytes;
+};
+
+static struct device devices[SISIM_CHANNELS];
+static struct channel_stats stats[SISIM_CHANNELS];
+
+int sisim_attach(const char *spec)
+{
+	char name[32];
+	unsigned int chn, i;
+	unsigned long from = 0, to = 0;
+	int n;
+
+	n = sscanf(spec, "%u:%31[a-z0-9]:%lu:%lu", &chn, name, &from, &to);
+	if (n < 2 || chn >= SISIM_CHANNELS) {
+		return -1;
+	}
+
+	for (i=0; i<NUM_TYPES; i++) {
+		if (!strcmp(types[i].name, name)) {
+			break;
+		}
+	}
+	if (i == NUM_TYPES) {
+		return -1;
+	}
+
+	devices[chn].type = &types[i];
+	devices[chn].from_ms = from;
+	devices[chn].to_ms = n >= 4 ? to : 0;
+	if (types[i].pak == PAK_MEMORY && !devices[chn].pak_memory) {
+		devices[chn].pak_memory = calloc(1, 0x8000);
+	}
+
+	return 0;
+}
+
+void sisim_listTypes(void)
+{
+	unsigned int i;
+
+	for (i=0; i<NUM_TYPES; i++) {
+		printf("    %-10s %s\n", types[i].name, types[i].description);
+	}
+}
+
+static uint32_t now_ms(void)
+{
+	return hal_getCycles() / (F_CPU / 1000);
+}
+
+static struct device *getDevice(uint8_t chn)
+{
+	struct device *dev;
+	uint32_t ms = now_ms();
+
+	if (chn >= SISIM_CHANNELS)
+		return NULL;
+
+	dev = &devices[chn];
+	if (!dev->type || ms < dev->from_ms || (dev->to_ms && ms >= dev->to_ms)) {
+		return NULL;
+	}
+
+	return dev;
+}
+
+/* Expansion port data CRC, bit by bit (polynomial 0x85) */
+static uint8_t dataCrc(const uint8_t *data)
+{
+	uint8_t crc = 0;
+	int i, b;
+
+	for (i=0; i<=32; i++) {
+		for (b=7; b>=0; b--) {
+			uint8_t xor_tap = (crc & 0x80) ? 0x85 : 0x00;
+			crc <<= 1;
+			if (i < 32 && (data[i] & (1<<b))) {
+				crc |= 1;
+			}
+			crc ^= xor_tap;
+		}
+	}
+
+	return crc;
+}
+
+/* Inputs change over time so reports are sent regularly. The A button
+ * toggles every 100ms and the main stick sweeps slowly. */
+static uint8_t sweep(void)
+{
+	return (now_ms() / 8) & 0x3f;
+}
+
+static int n64Command(struct device *dev, const uint8_t *tx, int tx_len, uint8_t *reply)
+{
+	uint16_t addr;
+	uint8_t *block;
+	static uint8_t tmp[32];
+
+	switch (tx[0])
+	{
+		case N64_GET_CAPABILITIES:
+		case N64_RESET:
+			memcpy(reply, dev->type->id, 3);
+			dev->caps_cycles = hal_getCycles();
+			return 3;
+
+		case N64_GET_STATUS:
+			memset(reply, 0, 4);
+			if ((dev->type->flags & FLAG_BRAWLER) &&
+					hal_getCycles() - dev->caps_cycles < BRAWLER_SETTLE_US * (F_CPU / 1000000)) {
+				return 4;
+			}
+			if ((now_ms() / 100) & 1) {
+				reply[0] |= 0x80; // A
+			}
+			reply[2] = sweep() - 0x20;
+			reply[3] = 0x10;
+			return 4;
+
+		case N64_EXPANSION_READ:
+			if (tx_len != 3 || dev->type->pak == PAK_NONE)
+				return 0;
+			addr = (tx[1] << 8 | tx[2]) & 0xffe0;
+			memset(tmp, 0, sizeof(tmp));
+			if (dev->type->pak == PAK_RUMBLE && addr == 0x8000) {
+				memset(tmp, 0x80, sizeof(tmp));
+			}
+			if (dev->type->pak == PAK_MEMORY && addr < 0x8000) {
+				memcpy(tmp, dev->pak_memory + addr, 32);
+			}
+			memcpy(reply, tmp, 32);
+			reply[32] = dataCrc(tmp);
+			return 33;
+
+		case N64_EXPANSION_WRITE:
+			if (tx_len != 35 || dev->type->pak == PAK_NONE)
+				return 0;
+			addr = (tx[1] << 8 | tx[2]) & 0xffe0;
+			block = (uint8_t*)tx + 3;
+			if (dev->type->pak == PAK_RUMBLE && addr == 0xc000) {
+				dev->rumbling = block[0] & 1;
+			}
+			if (dev->type->pak == PAK_MEMORY && addr < 0x8000) {
+				memcpy(dev->pak_memory + addr, block, 32);
+			}
+			reply[0] = dataCrc(block);
+			return 1;
+	}
+
+	return 0;
+}
+
+static int gcCommand(struct device *dev, const uint8_t *tx, int tx_len, uint8_t *reply)
+{
+	switch (tx[0])
+	{
+		case GC_GETID:
+			memcpy(reply, dev->type->id, 3);
+			return 3;
+
+		case GC_GETSTATUS1:
+			if (tx_len != 3 || dev->type->kind != DEV_GC)
+				return 0;
+			dev->rumbling = tx[2] & 1;
+			reply[0] = (now_ms() / 100) & 1 ? 0x01 : 0x00; // A
+			reply[1] = 0x80;
+			reply[2] = 0x60 + sweep();
+			reply[3] = 0x80;
+			reply[4] = 0x80;
+			reply[5] = 0x80;
+			reply[6] = 0x20;
+			reply[7] = 0x20;
+			return 8;
+
+		case GC_POLL_KB1:
+			if (tx_len != 3 || dev->type->kind != DEV_GC_KB)
+				return 0;
+			memset(reply, 0, 8);
+			reply[0] = now_ms() >> 4; // counter
+			if ((now_ms() / 100) & 1) {
+				reply[4] = GC_KEY_A;
+			}
+			reply[7] = reply[0] ^ reply[1] ^ reply[2] ^ reply[3] ^ reply[4] ^ reply[5];
+			return 8;
+	}
+
+	return 0;
+}
+
+int sisim_command(uint8_t chn, const uint8_t *tx, int tx_len, uint8_t *reply, uint16_t *latency_us)
+{
+	struct device *dev = getDevice(chn);
+	int len;
+
+	if (tx_len < 1 || chn >= SISIM_CHANNELS)
+		return 0;
+
+	stats[chn].commands[tx[0]]++;
+
+	if (!dev)
+		return 0;
+
+	if (dev->type->kind == DEV_N64) {
+		len = n64Command(dev, tx, tx_len, reply);
+	} else {
+		len = gcCommand(dev, tx, tx_len, reply);
+	}
+
+	if (len) {
+		stats[chn].replies++;
+		stats[chn].bytes += len;
+	}
+	*latency_us = dev->type->latency_us;
+
+	return len;
+}
+
+uint8_t sisim_oneLowCycles(uint8_t chn)
+{
+	struct device *dev = getDevice(chn);
+
+	if (!dev || !dev->type->one_low_cycles)
+		return SISIM_BIT_US * 16 / 4;
+
+	return dev->type->one_low_cycles;
+}
+
+void sisim_printStats(void)
+{
+	double s = hal_getCycles() / (double)F_CPU;
+	unsigned long total;
+	int chn, i;
+
+	for (chn=0; chn<SISIM_CHANNELS; chn++) {
+		for (i=0, total=0; i<256; i++) {
+			total += stats[chn].commands[i];
+		}
+		if (!total)
+			continue;
+
+		fprintf(stderr, "[sisim] chn %d (%s): %lu commands (%.0f/s), %lu replies, %lu bytes:",
+			chn, devices[chn].type ? devices[chn].type->name : "empty",
+			total, s > 0 ? total / s : 0, stats[chn].replies, stats[chn].bytes);
+		for (i=0; i<256; i++) {
+			if (stats[chn].commands[i]) {
+				fprintf(stderr, " %02x:%lu", i, stats[chn].commands[i]);
+			}
+		}
+		fprintf(stderr, "\n");
+	}
+}
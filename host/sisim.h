@@ -0,0 +1,30 @@
+#ifndef _host_sisim_h__
+#define _host_sisim_h__
+
+#include <stdint.h>
+
+/* Simulated controllers on the SI bus, for the host build.
+ *
+ * Devices are attached with a spec string: chn:type[:from_ms[:to_ms]]
+ * The device is connected from from_ms (default 0) until to_ms
+ * (default forever), in virtual time. */
+
+#define SISIM_CHANNELS		4
+#define SISIM_MAX_REPLY		36
+
+/* Bit period of the replies (4us) */
+#define SISIM_BIT_US		4
+
+int sisim_attach(const char *spec);
+void sisim_listTypes(void);
+
+/* Process a command from the adapter. Returns the reply length (0: no
+ * reply) and the delay before the reply starts. */
+int sisim_command(uint8_t chn, const uint8_t *tx, int tx_len, uint8_t *reply, uint16_t *latency_us);
+
+/* Low time of a 1 bit in the replies of a channel, in cycles */
+uint8_t sisim_oneLowCycles(uint8_t chn);
+
+void sisim_printStats(void);
+
+#endif // _host_sisim_h__
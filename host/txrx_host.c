@@ -0,0 +1,162 @@
+/*	gc_n64_usb : Gamecube or N64 controller to USB firmware
+	Copyright (C) 2007-2021  Raphael Assenat <raph@raphnet.net>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <string.h>
+#include "gcn64txrx.h"
+#include "hal.h"
+#include "sisim.h"
+
+/* Stand-in for gcn64txrx.S and gcn64txrx_multi.S. The devices are
+ * simulated by sisim.c: sendBytes() latches the command, receiveBytes()
+ * gets the reply. Both take the time they take on the wire, and an
+ * empty port times out like the assembly version does. */
+
+#define BIT_CYCLES				64		// 4us per bit (4us/1.5us timing)
+#define RX_NOTHING_CYCLES		510		// initial_wait_low: 102 loops of 5 cycles (32us)
+#define RX_NOTHING_LONG_CYCLES	1280	// gcn64_receiveBytesLong: 256 loops of 5 cycles
+#define RX_END_CYCLES			265		// waitlow: 53 loops of 5 cycles after the stop bit
+#define SAMPLE_NOTHING_CYCLES	511		// wait_start: 73 loops of 7 cycles (32us)
+#define SAMPLE_BYTE_CYCLES		40		// 4 samples of 10 cycles
+#define SAMPLE_CYCLES			10
+
+static unsigned char tx_buf[SISIM_CHANNELS][64];
+static unsigned char tx_len[SISIM_CHANNELS];
+
+/* Port bit of each channel (see Makefile) */
+static const unsigned char port_bits[SISIM_CHANNELS] = { 0x01, 0x04, 0x02, 0x08 };
+
+static void latch(unsigned char chn, const unsigned char *data, unsigned char n_bytes)
+{
+	if (n_bytes > sizeof(tx_buf[0]))
+		n_bytes = sizeof(tx_buf[0]);
+	memcpy(tx_buf[chn], data, n_bytes);
+	tx_len[chn] = n_bytes;
+}
+
+static void sendBytes(unsigned char chn, const unsigned char *data, unsigned char n_bytes)
+{
+	latch(chn, data, n_bytes);
+	hal_advanceCycles((n_bytes * 8 + 1) * BIT_CYCLES);
+}
+
+static unsigned char receiveBytes(unsigned char chn, unsigned char *dstbuf, unsigned char max_bytes, int nothing_cycles)
+{
+	unsigned char reply[SISIM_MAX_REPLY];
+	uint16_t latency_us = 0;
+	int len;
+
+	len = sisim_command(chn, tx_buf[chn], tx_len[chn], reply, &latency_us);
+	tx_len[chn] = 0;
+	if (!len) {
+		hal_advanceCycles(nothing_cycles);
+		return 0;
+	}
+	if (max_bytes == 0) {
+		hal_advanceCycles(latency_us * 16 + 8 * BIT_CYCLES);
+		return 0xfe;
+	}
+
+	hal_advanceCycles(latency_us * 16);
+	if (len >= max_bytes) {
+		// Returns at the stop bit of the last expected byte
+		hal_advanceCycles(max_bytes * 8 * BIT_CYCLES);
+		len = max_bytes;
+	} else {
+		hal_advanceCycles((len * 8 + 1) * BIT_CYCLES + RX_END_CYCLES);
+	}
+	memcpy(dstbuf, reply, len);
+
+	return len;
+}
+
+#define TXRX_CHANNEL(n) \
+	void gcn64_sendBytes##n(const unsigned char *data, unsigned char n_bytes) \
+	{ sendBytes(n, data, n_bytes); } \
+	unsigned char gcn64_receiveBytes##n(unsigned char *dstbuf, unsigned char max_bytes) \
+	{ return receiveBytes(n, dstbuf, max_bytes, RX_NOTHING_CYCLES); } \
+	unsigned char gcn64_receiveBytesLong##n(unsigned char *dstbuf, unsigned char max_bytes) \
+	{ return receiveBytes(n, dstbuf, max_bytes, RX_NOTHING_LONG_CYCLES); }
+
+TXRX_CHANNEL(0)
+TXRX_CHANNEL(1)
+TXRX_CHANNEL(2)
+TXRX_CHANNEL(3)
+
+void gcn64_sendBytesMulti(const unsigned char *data, unsigned char n_bytes, unsigned char mask)
+{
+	unsigned char chn;
+
+	for (chn=0; chn<SISIM_CHANNELS; chn++) {
+		if (mask & port_bits[chn]) {
+			latch(chn, data, n_bytes);
+		}
+	}
+	hal_advanceCycles((n_bytes * 8 + 1) * BIT_CYCLES);
+}
+
+/* Line level of a reply at a time (cycles from the start bit): 1us low
+ * (one_low cycles, for slow devices) for a 1, 3us low for a 0, 2us low
+ * for the stop bit. */
+static int lineLow(const unsigned char *reply, int len, int one_low, long t)
+{
+	long bit = t / BIT_CYCLES, pos = t % BIT_CYCLES;
+
+	if (t < 0 || bit > len * 8)
+		return 0;
+	if (bit == len * 8)
+		return pos < BIT_CYCLES / 2;
+	if (reply[bit / 8] & (0x80 >> (bit % 8)))
+		return pos < one_low;
+
+	return pos < BIT_CYCLES * 3 / 4;
+}
+
+unsigned char gcn64_sampleMulti(unsigned char *dstbuf, unsigned char n_bytes, unsigned char mask)
+{
+	unsigned char reply[2][SISIM_MAX_REPLY];
+	uint16_t latency_us[2];
+	int len[2] = { 0, 0 }, one_low[2];
+	int chn, s, first = -1;
+
+	for (chn=0; chn<2; chn++) {
+		if ((mask & port_bits[chn]) && tx_len[chn]) {
+			len[chn] = sisim_command(chn, tx_buf[chn], tx_len[chn], reply[chn], &latency_us[chn]);
+			one_low[chn] = sisim_oneLowCycles(chn);
+			if (len[chn] && (first < 0 || latency_us[chn] < first)) {
+				first = latency_us[chn];
+			}
+		}
+		tx_len[chn] = 0;
+	}
+
+	if (first < 0 || n_bytes == 0) {
+		hal_advanceCycles(SAMPLE_NOTHING_CYCLES);
+		return 0;
+	}
+
+	memset(dstbuf, 0, n_bytes);
+	for (s=0; s<n_bytes*4; s++) {
+		for (chn=0; chn<2; chn++) {
+			long t = s * SAMPLE_CYCLES - (len[chn] ? (latency_us[chn] - first) * 16 : 0);
+			if (!len[chn] || !lineLow(reply[chn], len[chn], one_low[chn], t)) {
+				dstbuf[s >> 2] |= 1 << (((s & 3) << 1) + chn);
+			}
+		}
+	}
+	hal_advanceCycles(first * 16 + n_bytes * SAMPLE_BYTE_CYCLES);
+
+	return n_bytes;
+}
@@ -0,0 +1,86 @@
+/*	gc_n64_usb : Gamecube or N64 controller to USB firmware
+	Copyright (C) 2007-2021  Raphael Assenat <raph@raphnet.net>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <string.h>
+#include "usb.h"
+#include "usb_host.h"
+#include "hal.h"
+
+/* Stand-in for usb.c. The host is always ready to take a report: sent
+ * reports are copied into a per-endpoint buffer and counted. Start of
+ * frames are delivered every millisecond of virtual time. */
+
+#define FRAME_CYCLES	(F_CPU / 1000)
+
+static uint64_t next_sof;
+
+struct usb_host_ep usb_host_eps[USB_HOST_NUM_EPS];
+const struct usb_parameters *usb_host_params;
+
+static void interruptSend(uint8_t ep, void *data, int len)
+{
+	struct usb_host_ep *e = &usb_host_eps[ep];
+
+	if (len > sizeof(e->last_report)) {
+		len = sizeof(e->last_report);
+	}
+	memcpy(e->last_report, data, len);
+	e->last_len = len;
+	e->n_reports++;
+
+	if (usb_host_params->interruptLoaded) {
+		usb_host_params->interruptLoaded(ep);
+	}
+}
+
+char usb_interruptReady_ep1(void) { return 1; }
+char usb_interruptReady_ep2(void) { return 1; }
+char usb_interruptReady_ep3(void) { return 1; }
+
+void usb_interruptSend_ep1(void *data, int len) { interruptSend(1, data, len); }
+void usb_interruptSend_ep2(void *data, int len) { interruptSend(2, data, len); }
+void usb_interruptSend_ep3(void *data, int len) { interruptSend(3, data, len); }
+
+/* The host never changes the idle rate */
+uint8_t usb_getIdle(uint8_t iface)
+{
+	if (!usb_host_params || iface >= usb_host_params->n_hid_interfaces)
+		return 0;
+
+	return usb_host_params->hid_params[iface].default_idle;
+}
+
+void usb_init(const struct usb_parameters *params)
+{
+	usb_host_params = params;
+}
+
+void usb_doTasks(void)
+{
+	hal_loopTick();
+
+	// On the target, this would be the SOF interrupt
+	while (hal_getCycles() >= next_sof) {
+		next_sof += FRAME_CYCLES;
+		if (usb_host_params && usb_host_params->sof) {
+			usb_host_params->sof();
+		}
+	}
+}
+
+void usb_shutdown(void)
+{
+}
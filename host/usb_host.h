@@ -0,0 +1,18 @@
+#ifndef _usb_host_h__
+#define _usb_host_h__
+
+#include <stdint.h>
+#include "usb.h"
+
+#define USB_HOST_NUM_EPS	4
+
+struct usb_host_ep {
+	unsigned long n_reports;
+	int last_len;
+	uint8_t last_report[64];
+};
+
+extern struct usb_host_ep usb_host_eps[USB_HOST_NUM_EPS];
+extern const struct usb_parameters *usb_host_params;
+
+#endif // _usb_host_h__
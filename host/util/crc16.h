@@ -0,0 +1,22 @@
+#ifndef _host_util_crc16_h__
+#define _host_util_crc16_h__
+
+#include <stdint.h>
+
+/* C equivalent given in the avr-libc documentation */
+static inline uint16_t _crc_xmodem_update(uint16_t crc, uint8_t data)
+{
+	int i;
+
+	crc = crc ^ ((uint16_t)data << 8);
+	for (i=0; i<8; i++) {
+		if (crc & 0x8000)
+			crc = (crc << 1) ^ 0x1021;
+		else
+			crc <<= 1;
+	}
+
+	return crc;
+}
+
+#endif // _host_util_crc16_h__
@@ -0,0 +1,12 @@
+#ifndef _host_util_delay_h__
+#define _host_util_delay_h__
+
+#include "hal.h"
+
+/* Delays do not sleep. They advance the virtual CPU clock instead, so
+ * everything measured against it (poll intervals, timeouts) keeps the
+ * proportions it has on the target while running as fast as possible. */
+#define _delay_us(us)	hal_advanceCycles((uint32_t)((us) * (F_CPU / 1000000.0)))
+#define _delay_ms(ms)	hal_advanceCycles((uint32_t)((ms) * (F_CPU / 1000.0)))
+
+#endif // _host_util_delay_h__
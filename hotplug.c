@@ -0,0 +1,91 @@
+/*	gc_n64_usb : Gamecube or N64 controller to USB firmware
+	Copyright (C) 2007-2021  Raphael Assenat <raph@raphnet.net>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "hotplug.h"
+#include "intervaltimer.h"
+
+#define STAGE_FAST		0
+#define STAGE_MEDIUM	1
+#define STAGE_SLOW		2
+
+struct hotplug_port {
+	uint8_t stage;
+	uint8_t probes;
+	uint16_t since; // Start of the fast stage, then time of the last probe
+};
+
+static struct hotplug_port ports[HOTPLUG_MAX_CHANNELS];
+
+void hotplug_init(void)
+{
+	uint8_t i;
+
+	for (i=0; i<HOTPLUG_MAX_CHANNELS; i++) {
+		hotplug_reset(i);
+	}
+}
+
+void hotplug_reset(uint8_t chn)
+{
+	if (chn >= HOTPLUG_MAX_CHANNELS)
+		return;
+
+	ports[chn].stage = STAGE_FAST;
+	ports[chn].probes = 0;
+	ports[chn].since = intervaltimer_now();
+}
+
+char hotplug_probeDue(uint8_t chn)
+{
+	struct hotplug_port *port;
+	uint16_t now, elapsed;
+
+	if (chn >= HOTPLUG_MAX_CHANNELS)
+		return 1;
+
+	port = &ports[chn];
+	now = intervaltimer_now();
+	elapsed = now - port->since;
+
+	switch (port->stage)
+	{
+		case STAGE_FAST:
+			if (elapsed < INTERVALTIMER_US_TO_TICKS(HOTPLUG_FAST_MS * 1000L)) {
+				return 1;
+			}
+			port->stage = STAGE_MEDIUM;
+			break;
+
+		case STAGE_MEDIUM:
+			if (elapsed < INTERVALTIMER_US_TO_TICKS(HOTPLUG_MEDIUM_INTERVAL_MS * 1000L)) {
+				return 0;
+			}
+			if (++port->probes >= HOTPLUG_MEDIUM_PROBES) {
+				port->stage = STAGE_SLOW;
+			}
+			break;
+
+		default:
+			if (elapsed < INTERVALTIMER_US_TO_TICKS(HOTPLUG_SLOW_INTERVAL_MS * 1000L)) {
+				return 0;
+			}
+			break;
+	}
+
+	port->since = now;
+
+	return 1;
+}
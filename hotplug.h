@@ -0,0 +1,29 @@
+#ifndef _hotplug_h__
+#define _hotplug_h__
+
+#include <stdint.h>
+
+#define HOTPLUG_MAX_CHANNELS	4
+
+/* Empty ports are probed at a decaying rate:
+ *
+ * - On every poll for HOTPLUG_FAST_MS after the port became empty,
+ * - then every HOTPLUG_MEDIUM_INTERVAL_MS, HOTPLUG_MEDIUM_PROBES times,
+ * - then every HOTPLUG_SLOW_INTERVAL_MS.
+ */
+#define HOTPLUG_FAST_MS				100
+#define HOTPLUG_MEDIUM_INTERVAL_MS	16
+#define HOTPLUG_MEDIUM_PROBES		60 // About one second
+#define HOTPLUG_SLOW_INTERVAL_MS	64
+
+void hotplug_init(void);
+
+/* The port just became empty (controller removed or not responding).
+ * Restarts probing at full rate. */
+void hotplug_reset(uint8_t chn);
+
+/* Returns true when the empty port should be probed now. The probe is
+ * assumed to happen when true is returned. */
+char hotplug_probeDue(uint8_t chn);
+
+#endif // _hotplug_h__
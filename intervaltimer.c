@@ -15,38 +15,187 @@
 	along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 #include <avr/io.h>
+#include <avr/interrupt.h>
 #include "intervaltimer.h"
 
+/* Timer1 is free-running (normal mode) and everything is compared
+ * against it in software. This lets the poll time be realigned on the
+ * USB start of frame without touching the counter, and lets each
+ * channel keep its own deadline. */
+
+#define FRAME_TICKS			INTERVALTIMER_US_TO_TICKS(1000)
+
+// Without a SOF for this long, the host is not sending them (suspend,
+// not configured yet..). Fall back to free-running polling.
+#define SOF_TIMEOUT_TICKS	INTERVALTIMER_US_TO_TICKS(3000)
+
+struct poll_timer {
+	int cur_interval;
+	uint16_t period;
+	uint8_t period_frames;
+	uint16_t last_poll;
+	uint8_t last_poll_frame;
+};
+
+static struct poll_timer timers[INTERVALTIMER_CHANNELS];
+static uint16_t sof_window; // ticks after SOF when polling must start. 0 = disabled
+
+static volatile uint16_t sof_stamp;
+static volatile uint8_t sof_frames;
+
 void intervaltimer_init(void)
 {
 	TCCR1A = 0;
-	TCCR1B = (1<<WGM12) | (1<<CS12) | (1<<CS00); // CTC, /1024 prescaler
+	TCCR1B = (1<<CS11) | (1<<CS10); // Normal mode, /64 prescaler
 }
 
-void intervaltimer_set(int interval_ms)
+uint16_t intervaltimer_now(void)
 {
-	static int cur_interval = 0;
+	uint16_t now;
+	uint8_t sreg = SREG;
+
+	// The SOF interrupt also reads TCNT1 (shared TEMP register)
+	cli();
+	now = TCNT1;
+	SREG = sreg;
+
+	return now;
+}
+
+void intervaltimer_set(uint8_t chn, int interval_ms)
+{
+	struct poll_timer *t = &timers[chn];
 
-	// We are setting TCNT back to zero, and updating
-	// the compare match register.
-	//
 	// To allows for simple repeated calling of this
-	// function from the main loop, only touch
-	// the counter when the interval changes.
-	if (cur_interval != interval_ms) {
-		cur_interval = interval_ms;
+	// function from the main loop, only restart
+	// when the interval changes.
+	if (t->cur_interval != interval_ms) {
+		t->cur_interval = interval_ms;
+
+		t->period = interval_ms * FRAME_TICKS;
+		t->period_frames = interval_ms;
+		t->last_poll = intervaltimer_now();
+	}
+}
+
+void intervaltimer_setSofLead(uint16_t lead_us)
+{
+	if (!lead_us) {
+		sof_window = 0;
+		return;
+	}
+
+	if (lead_us > 1000) {
+		lead_us = 1000;
+	}
+
+	// Window starts 'lead' before the next SOF. Keep it non-zero.
+	sof_window = FRAME_TICKS - INTERVALTIMER_US_TO_TICKS(lead_us);
+	if (!sof_window) {
+		sof_window = 1;
+	}
+}
+
+/* Called from the USB interrupt at each start of frame. */
+void intervaltimer_sof(void)
+{
+	sof_stamp = TCNT1;
+	sof_frames++;
+}
+
+static char sofSyncGet(struct poll_timer *t, uint16_t now)
+{
+	uint16_t stamp, since_sof;
+	uint8_t frames;
+	uint8_t sreg = SREG;
+
+	cli();
+	stamp = sof_stamp;
+	frames = sof_frames;
+	SREG = sreg;
+
+	since_sof = now - stamp;
+
+	if (since_sof > SOF_TIMEOUT_TICKS) {
+		return -1;
+	}
+
+	/* The host normally schedules the periodic (interrupt) transfers
+	 * right after the SOF, so being 'lead' before the next SOF is
+	 * being 'lead' before the next IN token. One poll every
+	 * interval_ms frames, at the same place in the frame each time. */
+	if ((uint8_t)(frames - t->last_poll_frame) < t->period_frames) {
+		return 0;
+	}
+	if (since_sof < sof_window) {
+		return 0;
+	}
+
+	t->last_poll_frame = frames;
+	t->last_poll = now;
+
+	return 1;
+}
+
+uint16_t intervaltimer_ticksLeft(uint8_t chn)
+{
+	struct poll_timer *t = &timers[chn];
+	uint16_t now = intervaltimer_now();
+	uint16_t stamp, since_sof, elapsed;
+	uint8_t frames, frames_left;
+	int32_t left;
+	uint8_t sreg = SREG;
+
+	if (sof_window) {
+		cli();
+		stamp = sof_stamp;
+		frames = sof_frames;
+		SREG = sreg;
+
+		since_sof = now - stamp;
+		if (since_sof <= SOF_TIMEOUT_TICKS) {
+			// Same conditions as sofSyncGet()
+			frames_left = 0;
+			if ((uint8_t)(frames - t->last_poll_frame) < t->period_frames) {
+				frames_left = t->period_frames - (uint8_t)(frames - t->last_poll_frame);
+			}
+			left = (int32_t)frames_left * FRAME_TICKS + sof_window - since_sof;
+			return left > 0 ? left : 0;
+		}
+	}
 
-		TCNT1 = 0;
-		OCR1A = interval_ms * (F_CPU/1024) / 1000;
+	elapsed = now - t->last_poll;
+	if (elapsed >= t->period) {
+		return 0;
 	}
+
+	return t->period - elapsed;
 }
 
-char intervaltimer_get(void)
+char intervaltimer_get(uint8_t chn)
 {
-	if (TIFR1 & (1<<OCF1A)) {
-		TIFR1 = 1<<OCF1A;
-		return 1;
+	struct poll_timer *t = &timers[chn];
+	uint16_t now = intervaltimer_now();
+	char res;
+
+	if (sof_window) {
+		res = sofSyncGet(t, now);
+		if (res >= 0) {
+			return res;
+		}
+	}
+
+	if ((uint16_t)(now - t->last_poll) < t->period) {
+		return 0;
+	}
+
+	// Like the compare match flag this replaces, fire once even if
+	// more than one period went by.
+	if ((uint16_t)(now - t->last_poll) - t->period >= t->period) {
+		t->last_poll = now;
+	} else {
+		t->last_poll += t->period;
 	}
 
-	return 0;
+	return 1;
 }
@@ -1,9 +1,25 @@
 #ifndef _interval_timer_h__
 #define _interval_timer_h__
 
+#include <stdint.h>
+
+/* Timer1 ticks are 4us (16MHz / 64). The counter wraps every 262ms. */
+#define INTERVALTIMER_US_TO_TICKS(us)	((us) / 4)
+
+/* One poll deadline per channel */
+#define INTERVALTIMER_CHANNELS	4
+
 void intervaltimer_init(void);
-void intervaltimer_set(int interval_ms);
-char intervaltimer_get(void);
+void intervaltimer_set(uint8_t chn, int interval_ms);
+char intervaltimer_get(uint8_t chn);
+uint16_t intervaltimer_now(void);
+/* Ticks until intervaltimer_get(chn) fires (0 when due) */
+uint16_t intervaltimer_ticksLeft(uint8_t chn);
 
-#endif // _interval_timer_h__
+/* Align polling on the USB frames: intervaltimer_get() fires lead_us
+ * before a SOF. 0 disables (free-running). intervaltimer_sof() must
+ * then be called at each SOF. */
+void intervaltimer_setSofLead(uint16_t lead_us);
+void intervaltimer_sof(void);
 
+#endif // _interval_timer_h__
@@ -0,0 +1,113 @@
+/*	gc_n64_usb : Gamecube or N64 controller to USB firmware
+	Copyright (C) 2007-2021  Raphael Assenat <raph@raphnet.net>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <string.h>
+#include "latency.h"
+#include "intervaltimer.h"
+
+/* Points are recorded from the main loop and from the USB interrupt
+ * (report loaded in the endpoint). When the last point is reached with
+ * all the previous ones recorded for the same poll, each stage duration
+ * is added to its histogram. Reports which are not sent (no change)
+ * never complete and are simply overwritten by the next poll. */
+
+static uint16_t stamps[LATENCY_MAX_CHANNELS][LATENCY_NUM_POINTS];
+static uint8_t stamped[LATENCY_MAX_CHANNELS]; // bit per point
+static uint8_t record_mask = 0xff;
+static uint16_t histograms[LATENCY_NUM_STAGES][LATENCY_NUM_BINS];
+
+static void addToHistogram(uint8_t stage, uint16_t ticks)
+{
+	uint8_t bin = 0;
+
+	while (ticks && bin < LATENCY_NUM_BINS-1) {
+		ticks >>= 1;
+		bin++;
+	}
+
+	if (histograms[stage][bin] != 0xffff) {
+		histograms[stage][bin]++;
+	}
+}
+
+void latency_stamp(uint8_t chn, uint8_t point, uint16_t t)
+{
+	uint16_t *s;
+	uint8_t sreg = SREG;
+
+	if (chn >= LATENCY_MAX_CHANNELS || !(record_mask & (1<<chn))) {
+		return;
+	}
+
+	s = stamps[chn];
+
+	cli();
+
+	if (point == LATENCY_POLL_START) {
+		stamped[chn] = 0;
+	}
+	s[point] = t;
+	stamped[chn] |= 1<<point;
+
+	if (stamped[chn] == (1<<LATENCY_NUM_POINTS)-1) {
+		addToHistogram(LATENCY_STAGE_SI, s[LATENCY_SI_DONE] - s[LATENCY_POLL_START]);
+		addToHistogram(LATENCY_STAGE_BUILD, s[LATENCY_REPORT_BUILT] - s[LATENCY_SI_DONE]);
+		addToHistogram(LATENCY_STAGE_USB, s[LATENCY_REPORT_LOADED] - s[LATENCY_REPORT_BUILT]);
+		addToHistogram(LATENCY_STAGE_TOTAL, s[LATENCY_REPORT_LOADED] - s[LATENCY_POLL_START]);
+		stamped[chn] = 0;
+	}
+
+	SREG = sreg;
+}
+
+void latency_mark(uint8_t chn, uint8_t point)
+{
+	latency_stamp(chn, point, intervaltimer_now());
+}
+
+void latency_reset(uint8_t channel_mask)
+{
+	uint8_t sreg = SREG;
+
+	cli();
+	memset(histograms, 0, sizeof(histograms));
+	memset(stamped, 0, sizeof(stamped));
+	record_mask = channel_mask ? channel_mask : 0xff;
+	SREG = sreg;
+}
+
+uint8_t latency_getHistogram(uint8_t stage, uint8_t *dst)
+{
+	uint8_t i;
+	uint16_t count;
+	uint8_t sreg = SREG;
+
+	if (stage >= LATENCY_NUM_STAGES) {
+		return 0;
+	}
+
+	for (i=0; i<LATENCY_NUM_BINS; i++) {
+		cli();
+		count = histograms[stage][i];
+		SREG = sreg;
+		*dst++ = count;
+		*dst++ = count >> 8;
+	}
+
+	return LATENCY_NUM_BINS * 2;
+}
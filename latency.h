@@ -0,0 +1,39 @@
+#ifndef _latency_h__
+#define _latency_h__
+
+#include <stdint.h>
+
+/* Points in the life of a report, per player channel */
+#define LATENCY_POLL_START		0 // Channel poll begins
+#define LATENCY_SI_DONE			1 // Last controller transaction completed
+#define LATENCY_REPORT_BUILT	2 // usbpad_update() done
+#define LATENCY_REPORT_LOADED	3 // Report written to the endpoint bank
+#define LATENCY_NUM_POINTS		4
+
+/* Histograms: one per stage between consecutive points, plus the total */
+#define LATENCY_STAGE_SI		0 // POLL_START to SI_DONE
+#define LATENCY_STAGE_BUILD		1 // SI_DONE to REPORT_BUILT
+#define LATENCY_STAGE_USB		2 // REPORT_BUILT to REPORT_LOADED
+#define LATENCY_STAGE_TOTAL		3 // POLL_START to REPORT_LOADED
+#define LATENCY_NUM_STAGES		4
+
+/* Bin 0 counts 0 ticks (4us), bin n counts 2^(n-1) to 2^n - 1 ticks,
+ * the last bin counts everything above. */
+#define LATENCY_NUM_BINS		12
+
+#define LATENCY_MAX_CHANNELS	2
+
+/* Record a point at intervaltimer_now() */
+void latency_mark(uint8_t chn, uint8_t point);
+/* Record a point at a timestamp taken earlier */
+void latency_stamp(uint8_t chn, uint8_t point, uint16_t t);
+
+/* Clear the histograms and record only the channels in mask (bit
+ * per channel) from now on. 0 records all channels. */
+void latency_reset(uint8_t channel_mask);
+
+/* Copy a stage histogram (LATENCY_NUM_BINS 16 bit counts, LSB first)
+ * to dst. Returns the number of bytes written. */
+uint8_t latency_getHistogram(uint8_t stage, uint8_t *dst);
+
+#endif // _latency_h__
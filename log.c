@@ -0,0 +1,80 @@
+/*	gc_n64_usb : Gamecube or N64 controller to USB firmware
+	Copyright (C) 2007-2021  Raphael Assenat <raph@raphnet.net>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <stdio.h>
+#include <stdarg.h>
+#include <avr/pgmspace.h>
+#include "log.h"
+#include "usart1.h"
+
+#ifdef LOG_BINARY
+
+#define LOGFMT(id, nargs, fmt)	nargs,
+static const uint8_t log_nargs[LOG_NUM_IDS] PROGMEM = {
+#include "logfmt.h"
+};
+#undef LOGFMT
+
+void log_event(uint8_t id, ...)
+{
+	uint8_t rec[2 + LOG_MAX_ARGS * 2];
+	uint8_t i, n, len = 2;
+	uint16_t arg;
+	va_list ap;
+
+	if (id >= LOG_NUM_IDS)
+		return;
+
+	rec[0] = LOG_SYNC;
+	rec[1] = id;
+	n = pgm_read_byte(&log_nargs[id]);
+
+	va_start(ap, id);
+	for (i=0; i<n; i++) {
+		arg = va_arg(ap, int);
+		rec[len++] = arg;
+		rec[len++] = arg >> 8;
+	}
+	va_end(ap);
+
+	usart1_send(rec, len);
+}
+
+#else
+
+#define LOGFMT(id, nargs, fmt)	static const char fmt_##id[] PROGMEM = fmt "\r\n";
+#include "logfmt.h"
+#undef LOGFMT
+
+#define LOGFMT(id, nargs, fmt)	fmt_##id,
+static PGM_P const log_formats[LOG_NUM_IDS] PROGMEM = {
+#include "logfmt.h"
+};
+#undef LOGFMT
+
+void log_event(uint8_t id, ...)
+{
+	va_list ap;
+
+	if (id >= LOG_NUM_IDS)
+		return;
+
+	va_start(ap, id);
+	vfprintf_P(stdout, pgm_read_ptr(&log_formats[id]), ap);
+	va_end(ap);
+}
+
+#endif
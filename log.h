@@ -0,0 +1,30 @@
+#ifndef _log_h__
+#define _log_h__
+
+#include <stdint.h>
+
+/* Tokenized logging. Messages are listed in logfmt.h and logged by id:
+ *
+ *   log_event(LOG_PAD_UPDATE_ERROR, channel, hw_channel);
+ *
+ * With LOG_BINARY, the format is not processed on the device. A record
+ * is sent instead: LOG_SYNC, id, then each argument (16 bit, LSB first).
+ * tools/logdecode turns the records back into text. Without LOG_BINARY,
+ * the message is formatted with printf as usual.
+ *
+ * A record is queued completely or not at all. Bytes other than
+ * LOG_SYNC outside of records are plain text (other printf output).
+ */
+#define LOG_SYNC		0xFF // Never in text
+#define LOG_MAX_ARGS	10
+
+#define LOGFMT(id, nargs, fmt)	id,
+enum {
+#include "logfmt.h"
+	LOG_NUM_IDS
+};
+#undef LOGFMT
+
+void log_event(uint8_t id, ...);
+
+#endif // _log_h__
@@ -0,0 +1,46 @@
+/* Log messages: LOGFMT(id, number of arguments, format)
+ *
+ * Included by log.h, log.c and tools/logdecode.c, so the firmware and
+ * the decoder always share the same table. Append new messages at the
+ * end: ids are positions in this list. Arguments are 16 bit integers,
+ * formats may only use d, i, u, x, X and c conversions. No newline.
+ */
+LOGFMT(LOG_PAD_UPDATE_ERROR,		2, "pad %d(%d) update error.")
+LOGFMT(LOG_NSW_PAD_IDX,				1, "pad idx=%d")
+LOGFMT(LOG_SI_ID,					5, "Id: %04x   (%d: %02x %02x %02x)")
+LOGFMT(LOG_NSW_GC_REPORT,			10, "%4d %4d %4d %4d %4d %4d| %4d %4d %4d %4d") // DEBUG builds only
+LOGFMT(LOG_HID_GET_JOY,				0, "Get joy report")
+LOGFMT(LOG_HID_ES_PLAYING,			0, "ES playing")
+LOGFMT(LOG_HID_GET_INPUT_UNKNOWN,	1, "Get input report %d ??")
+LOGFMT(LOG_HID_BLOCK_LOAD,			0, "block load")
+LOGFMT(LOG_HID_SIMULTANEOUS_MAX,	0, "simultaneous max")
+LOGFMT(LOG_HID_GET_CREATE_EFFECT,	0, "create effect")
+LOGFMT(LOG_HID_GET_FEATURE_UNKNOWN,	1, "Unknown feature %d")
+LOGFMT(LOG_HID_GET_UNHANDLED,		4, "Unhandled hid get report type=0x%02x, rq=0x%02x, wVal=0x%04x, wLen=0x%04x")
+LOGFMT(LOG_HID_SET_SHORT,			0, "shrt")
+LOGFMT(LOG_FFB_SET_STATUS,			2, "eff. set stat 0x%02x 0x%02x")
+LOGFMT(LOG_FFB_BLOCK_IDX,			1, "eff. blk. idx %d")
+LOGFMT(LOG_FFB_DISABLE_ACTUATORS,	0, "disable actuators")
+LOGFMT(LOG_FFB_PID_POOL,			0, "pid pool")
+LOGFMT(LOG_FFB_SET_EFFECT,			2, "set effect %d. duration: %u")
+LOGFMT(LOG_FFB_SET_PERIODIC,		2, "Set periodic - mag: %d, period: %u")
+LOGFMT(LOG_FFB_CONSTANT_FORCE,		1, "Constant force %d")
+LOGFMT(LOG_FFB_BAD_OP_LENGTH,		0, "Hey!")
+LOGFMT(LOG_FFB_EFFECT_OP,			2, "EFFECT OP: rom=%d, idx=0x%02x")
+LOGFMT(LOG_FFB_LOOPS,				2, "%d loops for %d ms")
+LOGFMT(LOG_FFB_START,				1, "Start (lp=%d)")
+LOGFMT(LOG_FFB_START_SOLO,			1, "Start solo (lp=%d)")
+LOGFMT(LOG_FFB_STOP,				1, "Stop (lp=%d)")
+LOGFMT(LOG_FFB_UNKNOWN_OP,			2, "OP?? %02x (lp=%d)")
+LOGFMT(LOG_FFB_UNUSED_EFFECT,		1, "Ununsed effect %d")
+LOGFMT(LOG_HID_SET_OUTPUT_UNKNOWN,	1, "Set output report 0x%02x")
+LOGFMT(LOG_HID_SET_CREATE_EFFECT,	1, "create effect %d")
+LOGFMT(LOG_HID_SET_FEATURE_UNKNOWN,	0, "What?")
+LOGFMT(LOG_HID_SET_BAD_TYPE,		0, "impossible")
+LOGFMT(LOG_USB_INVALID_EP_SIZE,		0, "Invalid ep size")
+LOGFMT(LOG_USB_CFG_EP_FAIL,			0, "CFG EP fail")
+LOGFMT(LOG_USB_UNHANDLED_CLASS_RQ,	1, "Unhandled class bRequest 0x%02x")
+LOGFMT(LOG_USB_UNHANDLED_EP_RQ,		1, "unhandled endpoint request. rq=%d")
+LOGFMT(LOG_USB_UNKNOWN_STRING,		0, "Unknown string id")
+LOGFMT(LOG_USB_UNHANDLED_RQ,		3, "t: %02x, rq: 0x%02x, val: %04x")
+LOGFMT(LOG_USB_UNHANDLED_WRITE,		1, "Unhandled control write [%d]")
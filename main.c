@@ -39,6 +39,9 @@
 #include "intervaltimer2.h"
 #include "requests.h"
 #include "stkchk.h"
+#include "latency.h"
+#include "hotplug.h"
+#include "log.h"
 
 #define MAX_PLAYERS		2
 
@@ -54,8 +57,6 @@
 #define KEYBOARD_PID2		0x0067
 #define KEYBOARD_JS_PID		0x0068
 
-int keyboard_main(void);
-
 /* Those .c files are included rather than linked for we
  * want the sizeof() operator to work on the arrays */
 #include "reportdesc.c"
@@ -508,32 +509,52 @@ static uint8_t _usbpad_hid_set_report(void *ctx, const struct usb_request *rq, c
 	return usbpad_hid_set_report((struct usbpad*)ctx, rq, dat, len);
 }
 
+/* Milliseconds, counted at each start of frame. For the HID idle rate. */
+static volatile uint16_t g_frame_count;
+
+static uint16_t frameCount(void)
+{
+	uint16_t count;
+	uint8_t sreg = SREG;
+
+	cli();
+	count = g_frame_count;
+	SREG = sreg;
+
+	return count;
+}
+
+static void usbSof(void)
+{
+	g_frame_count++;
+	intervaltimer_sof();
+}
+
+/* Set when the host starts over (bus reset, SET_CONFIGURATION). The
+ * current reports must then be sent even if they did not change. */
+static volatile uint8_t g_host_reset = 1;
+
+static void usbReconfigured(void)
+{
+	g_host_reset = 1;
+}
+
+static void interruptLoaded(uint8_t ep)
+{
+	// Endpoints 1 and 2 are players 1 and 2
+	latency_mark(ep - 1, LATENCY_REPORT_LOADED);
+}
+
 static struct usb_parameters usb_params = {
 	.flags = USB_PARAM_FLAG_CONFDESC_PROGMEM |
 					USB_PARAM_FLAG_REPORTDESC_PROGMEM,
 	.devdesc = (PGM_VOID_P)&device_descriptor,
-	.configdesc = (PGM_VOID_P)&cfg0, // Patched in main() for two players
-	.configdesc_ttllen = sizeof(cfg0), // Patched in main() for two players
 	.num_strings = NUM_USB_STRINGS,
 	.strings = g_usb_strings,
-
-	.n_hid_interfaces = 1 + 1, // One per player + one management interface (patched in main() for two players)
-	.hid_params = {
-		[0] = {
-			.reportdesc = gcn64_usbHidReportDescriptor,
-			.reportdesc_len = sizeof(gcn64_usbHidReportDescriptor),
-			.getReport = _usbpad_hid_get_report,
-			.setReport = _usbpad_hid_set_report,
-			.endpoint_size = 16,
-		},
-		[1] = {
-			.reportdesc = dataHidReport,
-			.reportdesc_len = sizeof(dataHidReport),
-			.getReport = hiddata_get_report,
-			.setReport = hiddata_set_report,
-			.endpoint_size = 64,
-		},
-	},
+	.sof = usbSof,
+	.interruptLoaded = interruptLoaded,
+	.reconfigured = usbReconfigured,
+	// configdesc and hid_params are set for the current mode by applyMode()
 };
 
 void hwinit(void)
@@ -649,7 +670,7 @@ Gamepad *detectPad_NSW(unsigned char chn, uint8_t* hw_channel)
 		unsigned char pad_type = gcn64_detectController(i);
 		ret = getGamepadByPadType(pad_type);
 		if(ret){
-			printf_P(PSTR("pad idx=%d\r\n"), i);
+			log_event(LOG_NSW_PAD_IDX, i);
 			*hw_channel = i;
 			break;
 		}
@@ -731,302 +752,230 @@ static uint8_t getSupportedModes(uint8_t *dst)
 	return idx;
 }
 
+/* Set by the main loop when no poll is in progress */
+static uint8_t g_bus_idle;
+/* Set for one main loop pass after a poll, when the gap to the next one
+ * is the longest there will be. */
+static uint8_t g_just_polled;
+
+/* A background SI transaction may only start when it ends before the
+ * next poll of every player is due. One that does not fit in the gap
+ * right after a poll never will (a pak block takes about 1.2ms, too long
+ * with 1ms polling). Instead of waiting forever, it starts then, and the
+ * next poll is late by the difference. */
+static uint8_t busFree(uint16_t us)
+{
+	uint16_t ticks = INTERVALTIMER_US_TO_TICKS(us);
+	uint8_t chn;
+
+	if (!g_bus_idle) {
+		return 0;
+	}
+	if (g_polling_suspended) {
+		return 1;
+	}
+
+	for (chn=0; chn<num_players; chn++) {
+		if (intervaltimer_ticksLeft(chn) <= ticks) {
+			return g_just_polled;
+		}
+	}
+
+	return 1;
+}
+
 static struct hiddata_ops hiddata_ops = {
 	.suspendPolling = setSuspendPolling,
 	.forceVibration = forceVibration,
 	.getSupportedModes = getSupportedModes,
+	.busFree = busFree,
 };
 
 #define STATE_WAIT_POLLTIME			0
 #define STATE_POLL_PAD				1
-#define STATE_WAIT_INTERRUPT_READY	2
 #define STATE_TRANSMIT				3
-#define STATE_WAIT_INTERRUPT_READY_P2	4
-#define STATE_TRANSMIT_P2				5
 
-int main(void)
-{
-	Gamepad *pads[MAX_PLAYERS] = { };
-	uint8_t hw_channel[MAX_PLAYERS] = { };
-	gamepad_data pad_data;
-	uint8_t gamepad_vibrate = 0;
-	uint8_t state = STATE_WAIT_POLLTIME;
-	uint8_t channel;
-	uint8_t i;
-	uint8_t nsw_mode;
+/*** Modes ***/
 
-	hwinit();
-	usart1_init();
-	eeprom_init();
-	intervaltimer_init();
-	intervaltimer2_init();
-	stkchk_init();
+/* What a player interface reports and how its report is built */
+struct player_iface {
+	PGM_VOID_P reportdesc;
+	uint16_t reportdesc_len;
+	void (*update)(struct usbpad *pad, const gamepad_data *pad_data);
+	int (*getReportSize)(void);
+};
 
-	nsw_mode = is_nsw_mode();
+static const struct player_iface iface_gamepad = {
+	.reportdesc = gcn64_usbHidReportDescriptor,
+	.reportdesc_len = sizeof(gcn64_usbHidReportDescriptor),
+	.update = usbpad_update,
+	.getReportSize = usbpad_getReportSize,
+};
 
-	switch (g_eeprom_data.cfg.mode)
-	{
-		default:
-		case CFG_MODE_STANDARD:
-			usbstrings_changeProductString_P(PSTR("GC/N64 to USB v"VERSIONSTR_SHORT));
-			break;
+static const struct player_iface iface_gamepad_nsw = {
+	.reportdesc = gcn64_usbHidReportDescriptorNSW,
+	.reportdesc_len = sizeof(gcn64_usbHidReportDescriptorNSW),
+	.update = usbpad_update,
+	.getReportSize = usbpad_getReportSize,
+};
 
-		case CFG_MODE_N64_ONLY:
-			usbstrings_changeProductString_P(PSTR("N64 to USB v"VERSIONSTR_SHORT));
-			device_descriptor.idProduct = N64_USB_PID;
-			break;
+static const struct player_iface iface_keyboard = {
+	.reportdesc = gcKeyboardReport,
+	.reportdesc_len = sizeof(gcKeyboardReport),
+	.update = usbpad_update_kb,
+	.getReportSize = usbpad_getReportSizeKB,
+};
 
-		case CFG_MODE_GC_ONLY:
-			usbstrings_changeProductString_P(PSTR("Gamecube to USB v"VERSIONSTR_SHORT));
-			device_descriptor.idProduct = GC_USB_PID;
-			break;
+static const struct usb_hid_parameters management_hid_params = {
+	.reportdesc = dataHidReport,
+	.reportdesc_len = sizeof(dataHidReport),
+	.getReport = hiddata_get_report,
+	.setReport = hiddata_set_report,
+	.endpoint_size = 64,
+};
 
-		case CFG_MODE_2P_STANDARD:
-			usbstrings_changeProductString_P(PSTR("Dual GC/N64 to USB v"VERSIONSTR_SHORT));
-			device_descriptor.idProduct = DUAL_GCN64_USB_PID;
-			num_players = 2;
-			break;
+/* Unchanged reports are repeated every 32ms in NSW mode, until the
+ * console sets an idle rate. Elsewhere, only changes are sent. */
+#define NSW_DEFAULT_IDLE	8 // 4ms units
+
+#define MODE_NSW			0xff // Not a CFG_MODE_*. Selected by the NSW_MODE switch.
+
+#define MODE_FLAG_KEYBOARD	1 // The NSW_MODE switch does not apply
+#define MODE_FLAG_NSW		2 // NSW device identity, no management interface,
+							  // report at every poll, controller on any port.
+
+struct mode_def {
+	uint8_t mode; // CFG_MODE_*
+	uint8_t flags;
+	uint16_t pid;
+	PGM_P product_string;
+	PGM_VOID_P configdesc;
+	uint16_t configdesc_ttllen;
+	uint8_t num_players;
+	// One interface (and endpoint) per player, in order. The management
+	// interface follows.
+	const struct player_iface *players[MAX_PLAYERS];
+};
 
-		case CFG_MODE_2P_N64_ONLY:
-			usbstrings_changeProductString_P(PSTR("Dual N64 to USB v"VERSIONSTR_SHORT));
-			device_descriptor.idProduct = DUAL_N64_USB_PID;
-			num_players = 2;
-			break;
+static const char str_standard[] PROGMEM = "GC/N64 to USB v"VERSIONSTR_SHORT;
+static const char str_n64_only[] PROGMEM = "N64 to USB v"VERSIONSTR_SHORT;
+static const char str_gc_only[] PROGMEM = "Gamecube to USB v"VERSIONSTR_SHORT;
+static const char str_2p_standard[] PROGMEM = "Dual GC/N64 to USB v"VERSIONSTR_SHORT;
+static const char str_2p_n64_only[] PROGMEM = "Dual N64 to USB v"VERSIONSTR_SHORT;
+static const char str_2p_gc_only[] PROGMEM = "Dual Gamecube to USB v"VERSIONSTR_SHORT;
+static const char str_keyboard[] PROGMEM = "GC KB to USB v"VERSIONSTR_SHORT;
+static const char str_keyboard_2[] PROGMEM = "KB to USB v"VERSIONSTR_SHORT;
+static const char str_kb_and_js[] PROGMEM = "GC KB+JS to USB v"VERSIONSTR_SHORT;
+
+/* The first entry is the default, for unknown modes. */
+static const struct mode_def modes[] PROGMEM = {
+	{ CFG_MODE_STANDARD, 0, GCN64_USB_PID, str_standard, &cfg0, sizeof(cfg0), 1, { &iface_gamepad } },
+	{ CFG_MODE_N64_ONLY, 0, N64_USB_PID, str_n64_only, &cfg0, sizeof(cfg0), 1, { &iface_gamepad } },
+	{ CFG_MODE_GC_ONLY, 0, GC_USB_PID, str_gc_only, &cfg0, sizeof(cfg0), 1, { &iface_gamepad } },
+	{ CFG_MODE_2P_STANDARD, 0, DUAL_GCN64_USB_PID, str_2p_standard, &cfg0_2p, sizeof(cfg0_2p), 2, { &iface_gamepad, &iface_gamepad } },
+	{ CFG_MODE_2P_N64_ONLY, 0, DUAL_N64_USB_PID, str_2p_n64_only, &cfg0_2p, sizeof(cfg0_2p), 2, { &iface_gamepad, &iface_gamepad } },
+	{ CFG_MODE_2P_GC_ONLY, 0, DUAL_GC_USB_PID, str_2p_gc_only, &cfg0_2p, sizeof(cfg0_2p), 2, { &iface_gamepad, &iface_gamepad } },
+	// Single-port adapters have the keyboard in port 1
+	{ CFG_MODE_KEYBOARD, MODE_FLAG_KEYBOARD, KEYBOARD_PID, str_keyboard, &cfg0_kb, sizeof(cfg0_kb), 1, { &iface_keyboard } },
+	{ CFG_MODE_KEYBOARD_2, MODE_FLAG_KEYBOARD, KEYBOARD_PID2, str_keyboard_2, &cfg0_kb, sizeof(cfg0_kb), 1, { &iface_keyboard } },
+	// Keyboard is always in second port on dual port adapters
+	{ CFG_MODE_KB_AND_JS, MODE_FLAG_KEYBOARD, KEYBOARD_JS_PID, str_kb_and_js, &cfg0_2p_keyboard, sizeof(cfg0_2p_keyboard), 2, { &iface_gamepad, &iface_keyboard } },
+	// Keeps the product string of the configured mode
+	{ MODE_NSW, MODE_FLAG_NSW, 0x0092, NULL, &cfg0_nsw, sizeof(cfg0_nsw), 1, { &iface_gamepad_nsw } },
+};
 
-		case CFG_MODE_2P_GC_ONLY:
-			usbstrings_changeProductString_P(PSTR("Dual Gamecube to USB v"VERSIONSTR_SHORT));
-			device_descriptor.idProduct = DUAL_GC_USB_PID;
-			num_players = 2;
-			break;
+static struct mode_def g_mode;
 
-		case CFG_MODE_KB_AND_JS:
-		case CFG_MODE_KEYBOARD:
-		case CFG_MODE_KEYBOARD_2:
-			keyboard_main();
+static void loadMode(uint8_t mode)
+{
+	uint8_t i;
+
+	for (i=0; i<sizeof(modes)/sizeof(modes[0]); i++) {
+		if (pgm_read_byte(&modes[i].mode) == mode) {
 			break;
+		}
+	}
+	if (i == sizeof(modes)/sizeof(modes[0])) {
+		i = 0;
 	}
 
-	if(nsw_mode){
+	memcpy_P(&g_mode, &modes[i], sizeof(struct mode_def));
+}
+
+/* Configure the USB device (descriptors, interfaces) for g_mode */
+static void applyMode(void)
+{
+	uint8_t i;
+
+	device_descriptor.idProduct = g_mode.pid;
+	if (g_mode.flags & MODE_FLAG_NSW) {
 		device_descriptor.idVendor = 0x0f0d;
-		device_descriptor.idProduct = 0x0092;
 		device_descriptor.bcdDevice = 0x0001;
 		device_descriptor.bcdUSB = 0x200;
 		device_descriptor.iSerialNumber = 0;
-		usb_params.configdesc = (PGM_VOID_P)&cfg0_nsw;
-		usb_params.configdesc_ttllen = sizeof(cfg0_nsw);
-		usb_params.n_hid_interfaces = 1;
-		usb_params.hid_params[0].reportdesc = gcn64_usbHidReportDescriptorNSW;
-		usb_params.hid_params[0].reportdesc_len = sizeof(gcn64_usbHidReportDescriptorNSW);
-		
-		num_players = 1;
 	}
 
-	// 2-players common
-	if (num_players == 2) {
-		usb_params.configdesc = (PGM_VOID_P)&cfg0_2p;
-		usb_params.configdesc_ttllen = sizeof(cfg0_2p);
-		usb_params.n_hid_interfaces = 3;
-		// Move the management interface is the last position
-		memcpy(usb_params.hid_params + 2, usb_params.hid_params + 1, sizeof(struct usb_hid_parameters));
-		// Add a second player interface between them
-		memcpy(usb_params.hid_params + 1, usb_params.hid_params + 0, sizeof(struct usb_hid_parameters));
-	}	
+	usb_params.configdesc = g_mode.configdesc;
+	usb_params.configdesc_ttllen = g_mode.configdesc_ttllen;
 
+	num_players = g_mode.num_players;
 	for (i=0; i<num_players; i++) {
-		usbpad_init(&usbpads[i], nsw_mode);
+		usb_params.hid_params[i].reportdesc = g_mode.players[i]->reportdesc;
+		usb_params.hid_params[i].reportdesc_len = g_mode.players[i]->reportdesc_len;
+		usb_params.hid_params[i].getReport = _usbpad_hid_get_report;
+		usb_params.hid_params[i].setReport = _usbpad_hid_set_report;
+		usb_params.hid_params[i].endpoint_size = 16;
 		usb_params.hid_params[i].ctx = &usbpads[i];
+		usb_params.hid_params[i].default_idle = (g_mode.flags & MODE_FLAG_NSW) ? NSW_DEFAULT_IDLE : 0;
+		usbpad_init(&usbpads[i], g_mode.flags & MODE_FLAG_NSW);
 	}
-
-	sei();
-	usb_init(&usb_params);
-
-	// Timebase for force feedback 'loop count'
-	intervaltimer2_set16ms();
-
-	while (1)
-	{
-		static char last_v[MAX_PLAYERS] = { };
-
-		if (stkchk_verify()) {
-			enterBootLoader();
-		}
-
-		usb_doTasks();
-		hiddata_doTask(&hiddata_ops);
-		// Run vibration tasks
-		if (intervaltimer2_get()) {
-			for (channel=0; channel < num_players; channel++) {
-				usbpad_vibrationTask(&usbpads[channel]);
-			}
-		}
-
-		switch(state)
-		{
-			case STATE_WAIT_POLLTIME:
-				if (!g_polling_suspended) {
-					intervaltimer_set(g_eeprom_data.cfg.poll_interval[0]);
-					if (intervaltimer_get()) {
-						state = STATE_POLL_PAD;
-					}
-				}
-				break;
-
-			case STATE_POLL_PAD:
-				led_test();
-				for (channel=0; channel<num_players; channel++)
-				{
-					/* Try to auto-detect controller if none*/
-					if (!pads[channel]) {
-						if(!nsw_mode){
-							pads[channel] = detectPad(channel);
-							hw_channel[channel] = channel;
-						} else {
-							pads[channel] = detectPad_NSW(channel, &hw_channel[channel]);
-						}
-						if (pads[channel] && (pads[channel]->hotplug)) {
-							// For gamecube, this make sure the next
-							// analog values we read become the center
-							// reference.
-							pads[channel]->hotplug(hw_channel[channel]);
-						}
-					}
-
-					/* Read from the pad by calling update */
-					if (pads[channel]) {
-						if (pads[channel]->update(hw_channel[channel])) {
-							error_count[channel]++;
-							if (error_count[channel] > MAX_READ_ERRORS) {
-								pads[channel] = NULL;
-								error_count[channel] = 0;
-								printf_P(PSTR("pad %d(%d) update error.\r\n"), channel, hw_channel[channel]);
-								continue;
-							}
-						} else {
-							error_count[channel]=0;
-						}
-
-						if (pads[channel]->changed(hw_channel[channel]) || nsw_mode)
-						{
-							pads[channel]->getReport(hw_channel[channel], &pad_data);
-							usbpad_update(&usbpads[channel], &pad_data);
-							state = STATE_WAIT_INTERRUPT_READY;
-							continue;
-						}
-					} else {
-						/* Just make sure the gamepad state holds valid data
-						 * to appear inactive (no buttons and axes in neutral) */
-						usbpad_update(&usbpads[channel], NULL);
-					}
-				}
-				/* If there were change on any of the gamepads, state will
-				 * be set to STATE_WAIT_INTERRUPT_READY. Otherwise, go back
-				 * to WAIT_POLLTIME. */
-				if (state == STATE_POLL_PAD) {
-					state = STATE_WAIT_POLLTIME;
-				}
-				break;
-
-			case STATE_WAIT_INTERRUPT_READY:
-				/* Wait until one of the interrupt endpoint is ready */
-				if (usb_interruptReady_ep1() || (num_players>1 && usb_interruptReady_ep2())) {
-					state = STATE_TRANSMIT;
-				}
-				break;
-
-			case STATE_TRANSMIT:
-				if (usb_interruptReady_ep1()) {
-					usb_interruptSend_ep1(usbpad_getReportBuffer(&usbpads[0]), usbpad_getReportSize());
-				}
-				if (num_players>1 && usb_interruptReady_ep2()) {
-					usb_interruptSend_ep2(usbpad_getReportBuffer(&usbpads[1]), usbpad_getReportSize());
-				}
-				state = STATE_WAIT_POLLTIME;
-				break;
-
-		}
-
-		for (channel=0; channel < num_players; channel++) {
-			gamepad_vibrate = usbpad_mustVibrate(&usbpads[channel]);
-			if (last_v[channel] != gamepad_vibrate) {
-				if (pads[channel] && pads[channel]->setVibration) {
-					pads[channel]->setVibration(channel, gamepad_vibrate);
-				}
-				last_v[channel] = gamepad_vibrate;
-			}
-		}
+	if (!(g_mode.flags & MODE_FLAG_NSW)) {
+		usb_params.hid_params[i++] = management_hid_params;
 	}
-
-	return 0;
+	usb_params.n_hid_interfaces = i;
 }
 
-int keyboard_main(void)
+static void (*const interruptSend[MAX_PLAYERS])(void *data, int len) = {
+	usb_interruptSend_ep1,
+	usb_interruptSend_ep2,
+};
+
+int main(void)
 {
 	Gamepad *pads[MAX_PLAYERS] = { };
+	uint8_t hw_channel[MAX_PLAYERS] = { };
 	gamepad_data pad_data;
 	uint8_t gamepad_vibrate = 0;
 	uint8_t state = STATE_WAIT_POLLTIME;
+	uint8_t poll_due = 0; // bit per channel
+	unsigned char last_report[MAX_PLAYERS][USBPAD_REPORT_SIZE] = { };
+	uint16_t last_report_time[MAX_PLAYERS] = { };
+	uint8_t resend, sreg;
+	unsigned char *report;
+	uint16_t now;
+	uint8_t idle;
+	int len;
+	char res;
 	uint8_t channel;
-	uint8_t i;
+	uint8_t nsw_mode;
 
 	hwinit();
 	usart1_init();
 	eeprom_init();
 	intervaltimer_init();
 	intervaltimer2_init();
+	hotplug_init();
 	stkchk_init();
 
-	switch (g_eeprom_data.cfg.mode)
-	{
-		default:
-		case CFG_MODE_KEYBOARD_2:
-			usbstrings_changeProductString_P(PSTR("KB to USB v"VERSIONSTR_SHORT));
-			device_descriptor.idProduct = KEYBOARD_PID2;
-
-			usb_params.configdesc = (PGM_VOID_P)&cfg0_kb;
-			usb_params.configdesc_ttllen = sizeof(cfg0_kb);
-
-			// replace Joystick report descriptor by keyboard
-			usb_params.hid_params[0].reportdesc = gcKeyboardReport;
-			usb_params.hid_params[0].reportdesc_len = sizeof(gcKeyboardReport);
-			break;
-
-		case CFG_MODE_KEYBOARD:
-			usbstrings_changeProductString_P(PSTR("GC KB to USB v"VERSIONSTR_SHORT));
-			device_descriptor.idProduct = KEYBOARD_PID;
-
-			usb_params.configdesc = (PGM_VOID_P)&cfg0_kb;
-			usb_params.configdesc_ttllen = sizeof(cfg0_kb);
-
-			// replace Joystick report descriptor by keyboard
-			usb_params.hid_params[0].reportdesc = gcKeyboardReport;
-			usb_params.hid_params[0].reportdesc_len = sizeof(gcKeyboardReport);
-			break;
-
-		case CFG_MODE_KB_AND_JS:
-			usbstrings_changeProductString_P(PSTR("GC KB+JS to USB v"VERSIONSTR_SHORT));
-			device_descriptor.idProduct = KEYBOARD_JS_PID;
-
-			usb_params.configdesc = (PGM_VOID_P)&cfg0_2p_keyboard;
-			usb_params.configdesc_ttllen = sizeof(cfg0_2p_keyboard);
-
-			// Move the management interface to the last position
-			memcpy(usb_params.hid_params + 2, usb_params.hid_params + 1, sizeof(struct usb_hid_parameters));
-			// Add a second player interface between them (still a joystick)
-			memcpy(usb_params.hid_params + 1, usb_params.hid_params + 0, sizeof(struct usb_hid_parameters));
-			// Convert second Joystick report descriptor to a keyboard
-			usb_params.hid_params[1].reportdesc = gcKeyboardReport;
-			usb_params.hid_params[1].reportdesc_len = sizeof(gcKeyboardReport);
-
-			usb_params.n_hid_interfaces = 3;
-			num_players = 2;
-
-			break;
+	loadMode(g_eeprom_data.cfg.mode);
+	if (g_mode.product_string) {
+		usbstrings_changeProductString_P(g_mode.product_string);
 	}
-
-	for (i=0; i<num_players; i++) {
-		usbpad_init(&usbpads[i], 0);
-		usb_params.hid_params[i].ctx = &usbpads[i];
+	if (is_nsw_mode() && !(g_mode.flags & MODE_FLAG_KEYBOARD)) {
+		loadMode(MODE_NSW);
 	}
+	applyMode();
+	nsw_mode = g_mode.flags & MODE_FLAG_NSW;
 
 	sei();
 	usb_init(&usb_params);
@@ -1043,7 +992,9 @@ int keyboard_main(void)
 		}
 
 		usb_doTasks();
+		g_bus_idle = (state == STATE_WAIT_POLLTIME);
 		hiddata_doTask(&hiddata_ops);
+		g_just_polled = 0;
 		// Run vibration tasks
 		if (intervaltimer2_get()) {
 			for (channel=0; channel < num_players; channel++) {
@@ -1055,8 +1006,22 @@ int keyboard_main(void)
 		{
 			case STATE_WAIT_POLLTIME:
 				if (!g_polling_suspended) {
-					intervaltimer_set(g_eeprom_data.cfg.poll_interval[0]);
-					if (intervaltimer_get()) {
+					intervaltimer_setSofLead(g_eeprom_data.ext.poll_sof_lead);
+					/* Each port has its own interval. Poll those that are due. */
+					for (channel=0; channel<num_players; channel++) {
+						intervaltimer_set(channel, g_eeprom_data.cfg.poll_interval[channel]);
+						if (intervaltimer_get(channel)) {
+							poll_due |= 1<<channel;
+							latency_mark(channel, LATENCY_POLL_START);
+						}
+					}
+					if (poll_due) {
+						led_test();
+						for (channel=0; channel<num_players; channel++) {
+							if ((poll_due & (1<<channel)) && pads[channel] && pads[channel]->prepare) {
+								pads[channel]->prepare(hw_channel[channel]);
+							}
+						}
 						state = STATE_POLL_PAD;
 					}
 				}
@@ -1065,81 +1030,101 @@ int keyboard_main(void)
 			case STATE_POLL_PAD:
 				for (channel=0; channel<num_players; channel++)
 				{
-					/* Try to auto-detect controller if none*/
-					if (!pads[channel]) {
-						pads[channel] = detectPad(channel);
+					if (!(poll_due & (1<<channel))) {
+						continue;
+					}
+					poll_due &= ~(1<<channel);
+
+					/* Try to auto-detect controller if none. Empty ports
+					 * are probed less and less often. */
+					if (!pads[channel] && hotplug_probeDue(channel)) {
+						if(!nsw_mode){
+							pads[channel] = detectPad(channel);
+							hw_channel[channel] = channel;
+						} else {
+							pads[channel] = detectPad_NSW(channel, &hw_channel[channel]);
+						}
+						if (pads[channel]) {
+							gcn64_countEvent(hw_channel[channel], GCN64_EVENT_DETECTED);
+						}
 						if (pads[channel] && (pads[channel]->hotplug)) {
 							// For gamecube, this make sure the next
 							// analog values we read become the center
 							// reference.
-							pads[channel]->hotplug(channel);
+							pads[channel]->hotplug(hw_channel[channel]);
 						}
 					}
 
 					/* Read from the pad by calling update */
 					if (pads[channel]) {
-						if (pads[channel]->update(channel)) {
+						res = pads[channel]->update(hw_channel[channel]);
+						if (res == GAMEPAD_UPDATE_PENDING) {
+							// Not done yet. Let the main loop run and come back.
+							poll_due |= 1<<channel;
+							continue;
+						}
+						if (res) {
 							error_count[channel]++;
 							if (error_count[channel] > MAX_READ_ERRORS) {
 								pads[channel] = NULL;
 								error_count[channel] = 0;
+								hotplug_reset(channel);
+								gcn64_countEvent(hw_channel[channel], GCN64_EVENT_DISCONNECTED);
+								log_event(LOG_PAD_UPDATE_ERROR, channel, hw_channel[channel]);
 								continue;
 							}
 						} else {
 							error_count[channel]=0;
+							latency_stamp(channel, LATENCY_SI_DONE, gcn64_lastTransactionTime(hw_channel[channel]));
 						}
 
-						if (pads[channel]->changed(channel))
+						if (pads[channel]->changed(hw_channel[channel]))
 						{
-							pads[channel]->getReport(channel, &pad_data);
-
-							if ((num_players == 1) && (channel == 0)) {
-								// single-port adapter in keyboard mode (kb in port 1)
-								usbpad_update_kb(&usbpads[channel], &pad_data);
-							} else if ((num_players == 2) && (channel == 1)) {
-								// dual-port adapter in keyboard mode (kb in port 2)
-								usbpad_update_kb(&usbpads[channel], &pad_data);
-							} else {
-								usbpad_update(&usbpads[channel], &pad_data);
-							}
-							state = STATE_WAIT_INTERRUPT_READY;
+							pads[channel]->getReport(hw_channel[channel], &pad_data);
+							g_mode.players[channel]->update(&usbpads[channel], &pad_data);
+							latency_mark(channel, LATENCY_REPORT_BUILT);
 							continue;
 						}
 					} else {
 						/* Just make sure the gamepad state holds valid data
 						 * to appear inactive (no buttons and axes in neutral) */
-						usbpad_update(&usbpads[channel], NULL);
+						g_mode.players[channel]->update(&usbpads[channel], NULL);
 					}
 				}
-				/* If there were change on any of the gamepads, state will
-				 * be set to STATE_WAIT_INTERRUPT_READY. Otherwise, go back
-				 * to WAIT_POLLTIME. */
-				if (state == STATE_POLL_PAD) {
-					state = STATE_WAIT_POLLTIME;
-				}
-				break;
-
-			case STATE_WAIT_INTERRUPT_READY:
-				/* Wait until one of the interrupt endpoint is ready */
-				if (usb_interruptReady_ep1() || (num_players>1 && usb_interruptReady_ep2())) {
+				/* When all channels are done, go to STATE_TRANSMIT. It
+				 * decides what needs to be sent. */
+				if (!poll_due) {
 					state = STATE_TRANSMIT;
 				}
 				break;
 
 			case STATE_TRANSMIT:
-				if (usb_interruptReady_ep1()) {
-					if (num_players == 1) {
-						// Single-port adapters have the keyboard in port 1
-						usb_interruptSend_ep1(usbpad_getReportBuffer(&usbpads[0]), usbpad_getReportSizeKB());
-					} else {
-						usb_interruptSend_ep1(usbpad_getReportBuffer(&usbpads[0]), usbpad_getReportSize());
+				/* Reports are copied and replace those not sent yet, if any.
+				 * A report identical to the last one sent is only repeated
+				 * when the idle period of the interface has expired, or when
+				 * the host has started over. The player interfaces come
+				 * first, so channel is the interface number. */
+				now = frameCount();
+				sreg = SREG;
+				cli();
+				resend = g_host_reset;
+				g_host_reset = 0;
+				SREG = sreg;
+				for (channel=0; channel<num_players; channel++) {
+					report = usbpad_getReportBuffer(&usbpads[channel]);
+					len = g_mode.players[channel]->getReportSize();
+					if (!resend && !memcmp(report, last_report[channel], len)) {
+						idle = usb_getIdle(channel);
+						if (!idle || (uint16_t)(now - last_report_time[channel]) < idle * 4) {
+							continue;
+						}
 					}
-				}
-				// Keyboard is always in second port on dual port adapters
-				if (num_players>1 && usb_interruptReady_ep2()) {
-					usb_interruptSend_ep2(usbpad_getReportBuffer(&usbpads[1]), usbpad_getReportSizeKB());
+					interruptSend[channel](report, len);
+					memcpy(last_report[channel], report, len);
+					last_report_time[channel] = now;
 				}
 				state = STATE_WAIT_POLLTIME;
+				g_just_polled = 1;
 				break;
 
 		}
@@ -1148,7 +1133,7 @@ int keyboard_main(void)
 			gamepad_vibrate = usbpad_mustVibrate(&usbpads[channel]);
 			if (last_v[channel] != gamepad_vibrate) {
 				if (pads[channel] && pads[channel]->setVibration) {
-					pads[channel]->setVibration(channel, gamepad_vibrate);
+					pads[channel]->setVibration(hw_channel[channel], gamepad_vibrate);
 				}
 				last_v[channel] = gamepad_vibrate;
 			}
@@ -1157,4 +1142,3 @@ int keyboard_main(void)
 
 	return 0;
 }
-
@@ -23,11 +23,14 @@
 #include "gcn64_protocol.h"
 #include "eeprom.h"
 #include "main.h" // for num_players
+#include "intervaltimer.h"
+#include "tpak.h"
 
 #undef BUTTON_A_RUMBLE_TEST
 
 /*********** prototypes *************/
 static void n64Init(unsigned char chn);
+static void n64Prepare(unsigned char chn);
 static char n64Update(unsigned char chn);
 static char n64Changed(unsigned char chn);
 static void n64GetReport(unsigned char chn, gamepad_data *dst);
@@ -41,6 +44,12 @@ static unsigned char n64_rumble_state[GAMEPAD_MAX_CHANNELS] = { };
 
 unsigned char tmpdata[40]; // Shared between channels
 
+/* Get capabilities result, from n64Prepare() */
+static unsigned char caps_pending[GAMEPAD_MAX_CHANNELS];
+static unsigned char caps_count[GAMEPAD_MAX_CHANNELS];
+static unsigned char caps_data[GAMEPAD_MAX_CHANNELS][N64_CAPS_REPLY_LENGTH];
+static uint16_t caps_time[GAMEPAD_MAX_CHANNELS];
+
 #define RSTATE_UNAVAILABLE	0
 #define RSTATE_OFF			1
 #define RSTATE_TURNON		2
@@ -50,7 +59,9 @@ unsigned char tmpdata[40]; // Shared between channels
 
 static void n64Init(unsigned char chn)
 {
-	n64Update(chn);
+	while (n64Update(chn) == GAMEPAD_UPDATE_PENDING) {
+		_delay_us(10);
+	}
 }
 
 static char initRumble(unsigned char chn)
@@ -86,14 +97,35 @@ static char controlRumble(unsigned char chn, char enable)
 	return -1;
 }
 
-static char n64Update(unsigned char chn)
+/* The brawler 64 wireless gamepad does not like when the get caps command is followed
+ * too closely by the get status command. Without a long pause between the two commands,
+ * it just returns all zeros.
+ *
+ * Use the longest pause the poll interval allows. */
+static uint16_t n64SettleTicks(unsigned char chn)
 {
-	unsigned char count;
-	unsigned char x,y;
-	unsigned char btns1, btns2;
-	unsigned char caps[N64_CAPS_REPLY_LENGTH];
-	unsigned char status[N64_GET_STATUS_REPLY_LENGTH];
+	// In NSW mode, there is one player but chn may be any port.
+	uint8_t interval = g_eeprom_data.cfg.poll_interval[num_players > 1 ? chn : 0];
+
+	if (interval >= 4) {
+		return INTERVALTIMER_US_TO_TICKS(2500);
+	} else if (interval >= 3) {
+		return INTERVALTIMER_US_TO_TICKS(1500);
+	} else if (interval >= 2) {
+		return INTERVALTIMER_US_TO_TICKS(1250);
+	}
 
+	return 0; // does not work at 1ms
+}
+
+/* First step of n64Update(): Send the get capabilities command.
+ *
+ * On dual port adapters, this is called for both ports before calling
+ * n64Update() on each, so the pause before get status is shared:
+ * Read caps port 1, Read caps port 2, delay, Read status port 1,
+ * read status port 2. */
+static void n64Prepare(unsigned char chn)
+{
 	/* Pad answer to N64_GET_CAPABILITIES
 	 *
 	 * 0x050000 : 0000 0101 0000 0000 0000 0000 : No expansion pack
@@ -104,47 +136,44 @@ static char n64Update(unsigned char chn)
 	 * Bit 1 tells is if there was something connected that has been removed.
 	 */
 	tmpdata[0] = N64_GET_CAPABILITIES;
-	count = gcn64_transaction(chn, tmpdata, 1, caps, sizeof(caps));
-	if (count != N64_CAPS_REPLY_LENGTH) {
+	caps_count[chn] = gcn64_transaction(chn, tmpdata, 1, caps_data[chn], N64_CAPS_REPLY_LENGTH);
+	caps_time[chn] = intervaltimer_now();
+	caps_pending[chn] = 1;
+}
+
+static char n64Update(unsigned char chn)
+{
+	unsigned char count;
+	unsigned char x,y;
+	unsigned char btns1, btns2;
+	unsigned char *caps = caps_data[chn];
+	unsigned char status[N64_GET_STATUS_REPLY_LENGTH];
+	uint16_t settle;
+
+	// Not prepared by the main loop (single port, just detected..)
+	if (!caps_pending[chn]) {
+		n64Prepare(chn);
+	}
+
+	if (caps_count[chn] != N64_CAPS_REPLY_LENGTH) {
+		if (caps_count[chn] && caps_count[chn] < N64_CAPS_REPLY_LENGTH) {
+			gcn64_countEvent(chn, GCN64_EVENT_SHORT_REPLY);
+		}
 		// a failed read could mean the pack or controller was gone. Init
 		// will be necessary next time we detect a pack is present.
 		n64_rumble_state[chn] = RSTATE_INIT;
+		caps_pending[chn] = 0;
 		return -1;
 	}
 
-	/* The brawler 64 wireless gamepad does not like when the get caps command is followed
-	 * too closely by the get status command. Without a long pause between the two commands,
-	 * it just returns all zeros. */
-	if (num_players > 1) {
-		// n64Update is called two times on two-player adapters. This
-		// means time lost waiting here doubles. Without this, the controllers
-		// are no longer being polled at the rate set in the gui, which is bad.
-		// (I want this setting to be reliable)
-		//
-		// So on dual port adapters, brawler 64 wireless controllers will be
-		// usable only at intervals >= 4ms.
-		//
-		// TODO: Interleave access like this to allow a higher polling
-		// frequency: Read caps port 1, Read caps port 2, delay, Read status port 1,
-		// read status port 2. (Maybe this could make 3ms intervals work)
-		//
-		if (g_eeprom_data.cfg.poll_interval[0] >= 8) {
-			_delay_ms(2.5);
-		} else if (g_eeprom_data.cfg.poll_interval[0] >= 6) {
-			_delay_ms(1.5);
-		} else if (g_eeprom_data.cfg.poll_interval[0] >= 4) {
-			_delay_ms(1.25);
-		}
-	}
-	else {
-		if (g_eeprom_data.cfg.poll_interval[0] >= 4) {
-			_delay_ms(2.5);
-		} else if (g_eeprom_data.cfg.poll_interval[0] >= 3) {
-			_delay_ms(1.5);
-		} else if (g_eeprom_data.cfg.poll_interval[0] >= 2) {
-			_delay_ms(1.25); // does not work at 1ms
-		}
+	/* Whatever happened on the other port since get caps counts. Do not
+	 * hold the main loop (USB, other port) for the rest: the main loop
+	 * calls again until the pause is over. */
+	settle = n64SettleTicks(chn);
+	if ((uint16_t)(intervaltimer_now() - caps_time[chn]) < settle) {
+		return GAMEPAD_UPDATE_PENDING;
 	}
+	caps_pending[chn] = 0;
 
 	/* Detect when a pack becomes present and schedule initialisation when it happens. */
 	if ((caps[2] & 0x01) && (n64_rumble_state[chn] == RSTATE_UNAVAILABLE)) {
@@ -155,6 +184,11 @@ static char n64Update(unsigned char chn)
 	if (!(caps[2] & 0x01) || (caps[2] & 0x02) ) {
 		n64_rumble_state[chn] = RSTATE_UNAVAILABLE;
 	}
+	/* Rumble pak writes would hit a powered Transfer pak. Once it is
+	 * powered off, the pak is initialised again like a new one. */
+	if (tpak_isPowered(chn)) {
+		n64_rumble_state[chn] = RSTATE_UNAVAILABLE;
+	}
 #ifdef BUTTON_A_RUMBLE_TEST
 	must_rumble[chn] = force_rumble[chn];
 	//printf("Caps: %02x %02x %02x\r\n", caps[0], caps[1], caps[2]);
@@ -211,6 +245,9 @@ static char n64Update(unsigned char chn)
 	tmpdata[0] = N64_GET_STATUS;
 	count = gcn64_transaction(chn, tmpdata, 1, status, sizeof(status));
 	if (count != N64_GET_STATUS_REPLY_LENGTH) {
+		if (count && count < N64_GET_STATUS_REPLY_LENGTH) {
+			gcn64_countEvent(chn, GCN64_EVENT_SHORT_REPLY);
+		}
 		return -1;
 	}
 
@@ -342,6 +379,7 @@ static void n64SetVibration(unsigned char chn, char enable)
 
 static Gamepad N64Gamepad = {
 	.init					= n64Init,
+	.prepare				= n64Prepare,
 	.update					= n64Update,
 	.changed				= n64Changed,
 	.getReport				= n64GetReport,
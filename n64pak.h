@@ -0,0 +1,26 @@
+#ifndef _n64pak_h__
+#define _n64pak_h__
+
+#include <stdint.h>
+
+/* Access to the N64 controller expansion port (controller pak, rumble
+ * pak, transfer pak...), 32 bytes at a time. */
+
+#define N64PAK_BLOCK_SIZE		32
+#define N64PAK_CPAK_SIZE		0x8000 // Controller pak memory
+
+#define N64PAK_OK				0
+#define N64PAK_NO_REPLY			1 // Nothing or partial reply
+#define N64PAK_CRC_ERROR		2 // Data CRC mismatch
+
+/* Address with its 5-bit checksum in the low bits, as sent on the wire */
+uint16_t n64pak_addrChecksum(uint16_t addr);
+
+/* CRC of a 32 byte block, as returned by the controller */
+uint8_t n64pak_dataCrc(const uint8_t *data);
+
+/* Return N64PAK_* */
+uint8_t n64pak_read(uint8_t chn, uint16_t addr, uint8_t *dst);
+uint8_t n64pak_write(uint8_t chn, uint16_t addr, const uint8_t *src);
+
+#endif // _n64pak_h__
@@ -10,8 +10,19 @@
 #define RQ_GCN64_GET_SIGNATURE			0x05
 #define RQ_GCN64_GET_CONTROLLER_TYPE	0x06
 #define RQ_GCN64_SET_VIBRATION			0x07
+#define RQ_GCN64_GET_LATENCY_HISTOGRAM	0x08
+#define RQ_GCN64_RESET_LATENCY			0x09
+#define RQ_GCN64_READ_SI_TRACE			0x0A
+#define RQ_GCN64_SET_SI_TRACE			0x0B
+#define RQ_GCN64_GET_SI_HEALTH			0x0C
+#define RQ_GCN64_GET_LOG_DROPPED		0x0D
 #define RQ_GCN64_RAW_SI_COMMAND			0x80
 #define RQ_GCN64_BLOCK_IO				0x81
+#define RQ_GCN64_PAK_READ				0x82
+#define RQ_GCN64_PAK_WRITE				0x83
+#define RQ_GCN64_TPAK_POWER				0x84
+#define RQ_GCN64_TPAK_READ				0x85
+#define RQ_GCN64_TPAK_WRITE				0x86
 #define RQ_RNT_GET_SUPPORTED_REQUESTS		0xF0
 #define RQ_RNT_GET_SUPPORTED_MODES		0xF1
 #define RQ_RNT_GET_SUPPORTED_CFG_PARAMS	0xF2
@@ -39,6 +50,7 @@
 #define CFG_PARAM_POLL_INTERVAL1	0x11
 #define CFG_PARAM_POLL_INTERVAL2	0x12
 #define CFG_PARAM_POLL_INTERVAL3	0x13
+#define CFG_PARAM_POLL_SOF_LEAD		0x18 // 16 bit, LSB first. Microseconds.
 
 #define CFG_PARAM_N64_SQUARE		0x20 // Not implemented
 #define CFG_PARAM_GC_MAIN_SQUARE	0x21 // Not implemented
@@ -51,4 +63,11 @@
 #define CFG_PARAM_DISABLE_ANALOG_TRIGGERS       0x32
 #define CFG_PARAM_SWAP_STICK_AND_DPAD   0x34
 
+/* Analog calibration (see calibration.h). 6 bytes: CENTER_X, CENTER_Y,
+ * DEADZONE, ANTI_DEADZONE, OUTER, CURVE. All zeros: not calibrated. */
+#define CFG_PARAM_CALIB_N64_STICK		0x40
+#define CFG_PARAM_CALIB_GC_MAIN			0x41
+#define CFG_PARAM_CALIB_GC_CSTICK		0x42
+#define CFG_PARAM_CALIB_GC_TRIGGERS		0x43 // CENTER_X/Y: L/R rest position
+
 #endif
@@ -0,0 +1,106 @@
+/*	gc_n64_usb : Gamecube or N64 controller to USB firmware
+	Copyright (C) 2007-2021  Raphael Assenat <raph@raphnet.net>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "sitrace.h"
+#include "intervaltimer.h"
+
+#ifdef SITRACE
+
+/* Written by gcn64_transaction() and read by hiddata, both from the
+ * main loop. No locking needed. */
+
+#define SITRACE_HEADER_SIZE	5
+#define SITRACE_MASK		(SITRACE_SIZE - 1)
+
+static uint8_t trace[SITRACE_SIZE];
+static uint8_t head, tail, used;
+static uint8_t enabled;
+static uint16_t dropped;
+
+void sitrace_enable(uint8_t enable)
+{
+	head = tail = used = 0;
+	dropped = 0;
+	enabled = enable;
+}
+
+static void put(uint8_t b)
+{
+	trace[head] = b;
+	head = (head + 1) & SITRACE_MASK;
+}
+
+void sitrace_record(uint8_t chn, const uint8_t *tx, uint8_t tx_len, const uint8_t *rx, uint8_t rx_count)
+{
+	uint8_t status, rx_len = 0, n_tx, n_rx, i;
+	uint16_t now;
+
+	if (!enabled)
+		return;
+
+	switch (rx_count)
+	{
+		case 0: status = SITRACE_STATUS_NO_REPLY; break;
+		case 0xff: status = SITRACE_STATUS_ERROR; break;
+		case 0xfe: status = SITRACE_STATUS_OVERFLOW; break;
+		default:
+			status = SITRACE_STATUS_OK;
+			rx_len = rx_count;
+	}
+
+	n_tx = tx_len < SITRACE_MAX_DATA ? tx_len : SITRACE_MAX_DATA;
+	n_rx = rx_len < SITRACE_MAX_DATA ? rx_len : SITRACE_MAX_DATA;
+
+	if (SITRACE_HEADER_SIZE + n_tx + n_rx > SITRACE_SIZE - used) {
+		if (dropped != 0xffff)
+			dropped++;
+		return;
+	}
+	used += SITRACE_HEADER_SIZE + n_tx + n_rx;
+
+	now = intervaltimer_now();
+	put((chn & 3) | (status << 4));
+	put(now);
+	put(now >> 8);
+	put(tx_len);
+	put(rx_len);
+	for (i=0; i<n_tx; i++) {
+		put(tx[i]);
+	}
+	for (i=0; i<n_rx; i++) {
+		put(rx[i]);
+	}
+}
+
+uint8_t sitrace_read(uint8_t *dst, uint8_t max)
+{
+	uint8_t count = 0;
+
+	while (used && count < max) {
+		dst[count++] = trace[tail];
+		tail = (tail + 1) & SITRACE_MASK;
+		used--;
+	}
+
+	return count;
+}
+
+uint16_t sitrace_dropped(void)
+{
+	return dropped;
+}
+
+#endif // SITRACE
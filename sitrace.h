@@ -0,0 +1,52 @@
+#ifndef _sitrace_h__
+#define _sitrace_h__
+
+#include <stdint.h>
+
+/* Trace of SI transactions, in RAM, drained over the management
+ * interface. Each record is:
+ *
+ *   0: channel (bits 0-1) | status << 4 (SITRACE_STATUS_*)
+ *   1: timestamp (Timer1 ticks of 4us, LSB first)
+ *   3: tx length
+ *   4: rx length
+ *   5: tx data (up to SITRACE_MAX_DATA bytes)
+ *   n: rx data (up to SITRACE_MAX_DATA bytes)
+ *
+ * Records which do not fit are dropped (and counted). Tracing is off
+ * until enabled.
+ *
+ * The trace needs SITRACE_SIZE bytes of RAM, too much to spare on the
+ * atmega32u2, so it is only built with SITRACE defined (add -DSITRACE to
+ * CFLAGS). Otherwise sitrace_record() does nothing and the trace requests
+ * are not supported.
+ */
+#define SITRACE_SIZE		128 // Power of 2
+#define SITRACE_MAX_DATA	8
+
+#define SITRACE_STATUS_OK		0
+#define SITRACE_STATUS_NO_REPLY	1
+#define SITRACE_STATUS_ERROR	2 // Frame error (0xff)
+#define SITRACE_STATUS_OVERFLOW	3 // Reply to a command expecting none (0xfe)
+
+#ifdef SITRACE
+
+/* Clears the trace, then starts (enable != 0) or stops tracing. */
+void sitrace_enable(uint8_t enable);
+
+/* rx_count is the raw gcn64_receiveBytes() result */
+void sitrace_record(uint8_t chn, const uint8_t *tx, uint8_t tx_len, const uint8_t *rx, uint8_t rx_count);
+
+/* Move up to max bytes from the trace to dst. Returns the count. */
+uint8_t sitrace_read(uint8_t *dst, uint8_t max);
+
+/* Records dropped since tracing was enabled (saturates at 0xffff) */
+uint16_t sitrace_dropped(void);
+
+#else
+
+static inline void sitrace_record(uint8_t chn, const uint8_t *tx, uint8_t tx_len, const uint8_t *rx, uint8_t rx_count) { }
+
+#endif
+
+#endif // _sitrace_h__
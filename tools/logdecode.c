@@ -0,0 +1,121 @@
+/*	gc_n64_usb : Gamecube or N64 controller to USB firmware
+	Copyright (C) 2007-2021  Raphael Assenat <raph@raphnet.net>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Decodes the binary log records (see log.h) in the serial output of
+ * firmware built with LOG_BINARY. Text is copied unchanged.
+ *
+ * The message table comes from logfmt.h, so rebuild this tool when it
+ * changes. Example:
+ *
+ *   stty -F /dev/ttyUSB0 57600 raw
+ *   ./logdecode /dev/ttyUSB0
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "log.h"
+
+struct logfmt {
+	const char *name;
+	int nargs;
+	const char *fmt;
+};
+
+#define LOGFMT(id, nargs, fmt)	{ #id, nargs, fmt },
+static const struct logfmt formats[LOG_NUM_IDS] = {
+#include "logfmt.h"
+};
+#undef LOGFMT
+
+/* printf one conversion at a time, so 16 bit values are extended to
+ * int as the firmware would have printed them. */
+static void printRecord(const struct logfmt *f, const uint16_t *args)
+{
+	const char *p = f->fmt;
+	char spec[16];
+	int a = 0, n;
+
+	while (*p) {
+		if (*p != '%') {
+			putchar(*p++);
+			continue;
+		}
+		if (p[1] == '%') {
+			putchar('%');
+			p += 2;
+			continue;
+		}
+
+		n = strcspn(p + 1, "diuxXc") + 2;
+		if (n >= sizeof(spec) || !p[n-1] || a >= f->nargs) {
+			printf("<bad format in %s>", f->name);
+			break;
+		}
+		memcpy(spec, p, n);
+		spec[n] = 0;
+		p += n;
+
+		if (spec[n-1] == 'd' || spec[n-1] == 'i') {
+			printf(spec, (int)(int16_t)args[a++]);
+		} else {
+			printf(spec, (unsigned int)args[a++]);
+		}
+	}
+	putchar('\n');
+}
+
+int main(int argc, char **argv)
+{
+	FILE *fptr = stdin;
+	uint16_t args[LOG_MAX_ARGS];
+	int c, id, i, lo, hi;
+
+	if (argc > 1) {
+		fptr = fopen(argv[1], "rb");
+		if (!fptr) {
+			perror(argv[1]);
+			return 1;
+		}
+	}
+
+	while ((c = fgetc(fptr)) != EOF) {
+		if (c != LOG_SYNC) {
+			putchar(c);
+			continue;
+		}
+
+		id = fgetc(fptr);
+		if (id == EOF)
+			break;
+		if (id >= LOG_NUM_IDS) {
+			printf("<unknown log id %d>\n", id);
+			continue;
+		}
+
+		for (i=0; i<formats[id].nargs; i++) {
+			lo = fgetc(fptr);
+			hi = fgetc(fptr);
+			if (lo == EOF || hi == EOF)
+				return 0;
+			args[i] = lo | hi << 8;
+		}
+		printRecord(&formats[id], args);
+		fflush(stdout);
+	}
+
+	return 0;
+}
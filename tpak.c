@@ -0,0 +1,130 @@
+/*	gc_n64_usb : Gamecube or N64 controller to USB firmware
+	Copyright (C) 2007-2021  Raphael Assenat <raph@raphnet.net>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <string.h>
+#include "tpak.h"
+#include "n64pak.h"
+
+#define BANK_UNKNOWN	0xff
+
+/* Current window of each channel, to skip redundant bank writes */
+static uint8_t cur_bank[TPAK_MAX_CHANNELS] = { BANK_UNKNOWN, BANK_UNKNOWN, BANK_UNKNOWN, BANK_UNKNOWN };
+static uint8_t powered; // bit per channel
+
+/* The pak registers take the same value in all 32 bytes */
+static uint8_t writeRegister(uint8_t chn, uint16_t addr, uint8_t value)
+{
+	uint8_t block[N64PAK_BLOCK_SIZE];
+
+	memset(block, value, sizeof(block));
+
+	return n64pak_write(chn, addr, block);
+}
+
+uint8_t tpak_powerStep(uint8_t chn, uint8_t on, uint8_t step, uint8_t *status)
+{
+	uint8_t block[N64PAK_BLOCK_SIZE];
+	uint8_t res;
+
+	if (chn >= TPAK_MAX_CHANNELS)
+		return N64PAK_NO_REPLY;
+
+	switch (step)
+	{
+		case 0:
+			cur_bank[chn] = BANK_UNKNOWN;
+			// The main loop polls between steps. Keep rumble off already.
+			if (on) {
+				powered |= 1<<chn;
+			}
+			res = writeRegister(chn, TPAK_ADDR_POWER, on ? TPAK_POWER_ON : TPAK_POWER_OFF);
+			if (on ? res != N64PAK_OK : res == N64PAK_OK) {
+				powered &= ~(1<<chn);
+			}
+			break;
+
+		case 1:
+			res = writeRegister(chn, TPAK_ADDR_STATUS, on ? TPAK_STATUS_ACCESS : 0);
+			break;
+
+		default:
+			res = n64pak_read(chn, TPAK_ADDR_STATUS, block);
+			*status = block[0];
+			break;
+	}
+
+	return res;
+}
+
+uint8_t tpak_isPowered(uint8_t chn)
+{
+	return chn < TPAK_MAX_CHANNELS && (powered & (1<<chn));
+}
+
+uint8_t tpak_needBank(uint8_t chn, uint16_t gb_addr)
+{
+	return chn < TPAK_MAX_CHANNELS && cur_bank[chn] != gb_addr / TPAK_WINDOW_SIZE;
+}
+
+uint8_t tpak_selectBank(uint8_t chn, uint16_t gb_addr)
+{
+	uint8_t bank = gb_addr / TPAK_WINDOW_SIZE;
+	uint8_t res;
+
+	if (chn >= TPAK_MAX_CHANNELS)
+		return N64PAK_NO_REPLY;
+
+	if (cur_bank[chn] == bank)
+		return N64PAK_OK;
+
+	res = writeRegister(chn, TPAK_ADDR_BANK, bank);
+	cur_bank[chn] = res == N64PAK_OK ? bank : BANK_UNKNOWN;
+
+	return res;
+}
+
+uint8_t tpak_read(uint8_t chn, uint16_t gb_addr, uint8_t *dst)
+{
+	uint8_t res;
+
+	res = tpak_selectBank(chn, gb_addr);
+	if (res != N64PAK_OK)
+		return res;
+
+	res = n64pak_read(chn, TPAK_ADDR_WINDOW + (gb_addr % TPAK_WINDOW_SIZE), dst);
+	if (res != N64PAK_OK) {
+		// The pak may have been swapped or reset. Write the bank again.
+		cur_bank[chn] = BANK_UNKNOWN;
+	}
+
+	return res;
+}
+
+uint8_t tpak_write(uint8_t chn, uint16_t gb_addr, const uint8_t *src)
+{
+	uint8_t res;
+
+	res = tpak_selectBank(chn, gb_addr);
+	if (res != N64PAK_OK)
+		return res;
+
+	res = n64pak_write(chn, TPAK_ADDR_WINDOW + (gb_addr % TPAK_WINDOW_SIZE), src);
+	if (res != N64PAK_OK) {
+		cur_bank[chn] = BANK_UNKNOWN;
+	}
+
+	return res;
+}
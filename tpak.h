@@ -0,0 +1,51 @@
+#ifndef _tpak_h__
+#define _tpak_h__
+
+#include <stdint.h>
+
+/* N64 Transfer Pak. The Game Boy cartridge address space is seen through
+ * a 16KB window at 0xC000 in the expansion port. The window is moved by
+ * writing the bank number (GB address / 0x4000) to 0xA000. */
+
+#define TPAK_MAX_CHANNELS		4
+
+#define TPAK_ADDR_POWER			0x8000 // Write 0x84 for on, 0xFE for off
+#define TPAK_ADDR_BANK			0xA000
+#define TPAK_ADDR_STATUS		0xB000 // Write 1 to enable cartridge access
+#define TPAK_ADDR_WINDOW		0xC000
+#define TPAK_WINDOW_SIZE		0x4000
+
+#define TPAK_POWER_ON			0x84
+#define TPAK_POWER_OFF			0xFE
+
+/* Bits of the status byte */
+#define TPAK_STATUS_ACCESS		0x01 // Cartridge access enabled
+#define TPAK_STATUS_RESET		0x04 // Reset detected
+#define TPAK_STATUS_RESETTING	0x08 // Cartridge is being reset
+#define TPAK_STATUS_NO_CART		0x40 // Cartridge removed or absent
+#define TPAK_STATUS_POWERED		0x80
+
+/* Power the pak and enable cartridge access (or the opposite), one
+ * transaction per call for step 0 to TPAK_POWER_STEPS-1. Stop at the
+ * first error. Return N64PAK_*, and the status byte in *status at the
+ * last step. */
+#define TPAK_POWER_STEPS		3
+uint8_t tpak_powerStep(uint8_t chn, uint8_t on, uint8_t step, uint8_t *status);
+
+/* True from the start of a power on sequence until the pak is powered
+ * off (or powering it on failed). Rumble pak accesses (0x8000, 0xC000)
+ * would hit the registers and the cartridge. */
+uint8_t tpak_isPowered(uint8_t chn);
+
+/* Access 32 bytes of the Game Boy cartridge address space (ROM, MBC
+ * registers, SRAM). The window is moved first if needed. Return N64PAK_*. */
+uint8_t tpak_read(uint8_t chn, uint16_t gb_addr, uint8_t *dst);
+uint8_t tpak_write(uint8_t chn, uint16_t gb_addr, const uint8_t *src);
+
+/* For callers doing one transaction at a time: when tpak_needBank() is
+ * true, tpak_read() and tpak_write() would first move the window (one
+ * more transaction). tpak_selectBank() does only that. */
+uint8_t tpak_needBank(uint8_t chn, uint16_t gb_addr);
+uint8_t tpak_selectBank(uint8_t chn, uint16_t gb_addr);
+
+#endif // _tpak_h__
@@ -16,8 +16,21 @@
 */
 #include <stdio.h>
 #include <avr/io.h>
+#include <avr/interrupt.h>
 #include "usart1.h"
 
+/* Bytes are queued and sent by the data register empty interrupt, so
+ * printf does not wait for the (slow) UART. When the buffer is full,
+ * bytes are dropped and counted. Each call is queued completely or not
+ * at all, so binary log records are never truncated. */
+#define TX_BUF_SIZE	64 // Power of 2
+#define TX_BUF_MASK	(TX_BUF_SIZE-1)
+
+static unsigned char tx_buf[TX_BUF_SIZE];
+static volatile uint8_t tx_head; // Next byte to write
+static volatile uint8_t tx_tail; // Next byte to send
+static volatile uint16_t tx_dropped;
+
 #ifdef UART1_STDOUT
 static int uart1_putchar(char c, FILE *stream)
 {
@@ -29,11 +42,48 @@ static FILE mystdout = FDEV_SETUP_STREAM(uart1_putchar, NULL,
                                            _FDEV_SETUP_WRITE);
 #endif
 
+ISR(USART1_UDRE_vect)
+{
+	UDR1 = tx_buf[tx_tail];
+	tx_tail = (tx_tail + 1) & TX_BUF_MASK;
+	if (tx_tail == tx_head) {
+		UCSR1B &= ~(1<<UDRIE1);
+	}
+}
+
 void usart1_send(void *data, int len)
 {
-	while (!(UCSR1A & (1<<UDRE1)));
-	UDR1 = *((unsigned char*)data);
-	data++;
+	const unsigned char *d = data;
+	uint8_t sreg = SREG;
+	uint32_t dropped;
+
+	// May be called from interrupt context too
+	cli();
+	if (len > ((tx_tail - tx_head - 1) & TX_BUF_MASK)) {
+		dropped = (uint32_t)tx_dropped + len;
+		tx_dropped = dropped > 0xffff ? 0xffff : dropped;
+		len = 0;
+	}
+	while (len--) {
+		tx_buf[tx_head] = *d++;
+		tx_head = (tx_head + 1) & TX_BUF_MASK;
+	}
+	if (tx_head != tx_tail) {
+		UCSR1B |= (1<<UDRIE1);
+	}
+	SREG = sreg;
+}
+
+uint16_t usart1_getDropped(void)
+{
+	uint16_t dropped;
+	uint8_t sreg = SREG;
+
+	cli();
+	dropped = tx_dropped;
+	SREG = sreg;
+
+	return dropped;
 }
 
 void usart1_init(void)
@@ -1,7 +1,13 @@
 #ifndef _usart1_h__
 #define _usart1_h__
 
+#include <stdint.h>
+
+/* Queue bytes for transmission. Never waits: when they do not all fit
+ * in the buffer, they are all dropped. */
 void usart1_send(void *data, int len);
 void usart1_init(void);
+/* Bytes dropped so far (saturates at 0xffff) */
+uint16_t usart1_getDropped(void);
 
 #endif // _usart1_h__
@@ -23,9 +23,15 @@
 #include <avr/pgmspace.h>
 
 #include "usb.h"
+#include "log.h"
 
 #undef VERBOSE
 
+// Endpoint memory on ATmega8u2/16u2/32u2
+#ifndef USB_DPRAM_SIZE
+#define USB_DPRAM_SIZE	176
+#endif
+
 #define STATE_POWERED		0
 #define STATE_DEFAULT		1
 #define STATE_ADDRESS		2
@@ -35,12 +41,20 @@ static volatile uint8_t g_usb_suspend;
 //static uint8_t g_ep0_buf[64];
 static uint8_t g_device_state = STATE_DEFAULT;
 static uint8_t g_current_config;
-static void *interrupt_data;
-static volatile int interrupt_data_len = -1;
-static void *interrupt_data2;
-static volatile int interrupt_data_len2 = -1;
-static void *interrupt_data3;
-static volatile int interrupt_data_len3 = -1;
+
+/* Interrupt IN reports are copied in a ping-pong buffer pair. The main
+ * loop writes to the 'fill' buffer, which the interrupt never touches,
+ * then swaps it with interrupts disabled. A report that was not sent yet
+ * is simply replaced by the newer one. */
+struct interrupt_ep {
+	uint8_t buf[2][USB_INTERRUPT_REPORT_MAX];
+	uint8_t len[2];
+	uint8_t fill;
+	volatile int8_t pending; // buffer waiting for an IN token, -1 if none
+};
+static struct interrupt_ep interrupt_eps[3] = {
+	{ .pending = -1 }, { .pending = -1 }, { .pending = -1 },
+};
 
 #define CONTROL_WRITE_BUFSIZE	64
 static struct usb_request control_write_rq;
@@ -50,6 +64,33 @@ static uint8_t control_write_buf[CONTROL_WRITE_BUFSIZE];
 
 static const struct usb_parameters *g_params;
 
+/* HID idle rate of each interface (SET_IDLE/GET_IDLE). Applies to all
+ * the reports of the interface, the report id is ignored. */
+static uint8_t hid_idle[MAX_HID_INTERFACES];
+
+/* A new host (or the same one starting over) has not set any idle rate
+ * yet and has not seen the reports sent so far. */
+static void hostReset(void)
+{
+	uint8_t i;
+
+	for (i=0; i<MAX_HID_INTERFACES; i++) {
+		hid_idle[i] = g_params->hid_params[i].default_idle;
+	}
+
+	if (g_params->reconfigured) {
+		g_params->reconfigured();
+	}
+}
+
+uint8_t usb_getIdle(uint8_t iface)
+{
+	if (iface >= MAX_HID_INTERFACES)
+		return 0;
+
+	return hid_idle[iface];
+}
+
 static void initControlWrite(const struct usb_request *rq)
 {
 	memcpy(&control_write_rq, rq, sizeof(struct usb_request));
@@ -87,8 +128,9 @@ static uint8_t getEPsizebits(int epsize)
 
 static void setupEndpoints()
 {
-	uint8_t epsize;
+	uint8_t epsize, banks;
 	int i;
+	int dpram_free = USB_DPRAM_SIZE - 64; // EP0
 
 	/*** EP0 ***/
 
@@ -108,6 +150,14 @@ static void setupEndpoints()
 	}
 //	printf_P("ok\r\n");
 
+	/* Interrupt IN endpoints get a second bank when there is room
+	 * left in the DPRAM once all of them have one, in endpoint order.
+	 * This lets the next report wait in the second bank while the
+	 * first is in flight. */
+	for (i=0; i<g_params->n_hid_interfaces; i++) {
+		dpram_free -= g_params->hid_params[i].endpoint_size;
+	}
+
 	for (i=0; i<g_params->n_hid_interfaces; i++) {
 		UENUM = 0x01 + i;  // select endpoint
 
@@ -116,14 +166,19 @@ static void setupEndpoints()
 		UEIENX = (1<<TXINE);
 		epsize = getEPsizebits(g_params->hid_params[i].endpoint_size);
 		if (epsize == 0xff) {
-			printf_P(PSTR("Invalid ep size\r\n"));
+			log_event(LOG_USB_INVALID_EP_SIZE);
 			return;
 		}
-		UECFG1X = epsize|(1<<ALLOC); // one bank, and allocate
+		banks = 0; // one bank
+		if (dpram_free >= g_params->hid_params[i].endpoint_size) {
+			dpram_free -= g_params->hid_params[i].endpoint_size;
+			banks = (1<<EPBK0); // two banks
+		}
+		UECFG1X = epsize|banks|(1<<ALLOC); // allocate
 		UEINTX = 0;
 
 		if (!(UESTA0X & (1<<CFGOK))) {
-			printf_P(PSTR("CFG EP fail\r\n"));
+			log_event(LOG_USB_CFG_EP_FAIL);
 			return;
 		}
 	}
@@ -269,6 +324,7 @@ static void handleSetupPacket(struct usb_request *rq)
 						} else {
 							g_device_state = STATE_CONFIGURED;
 						}
+						hostReset();
 						while (!(UEINTX & (1<<TXINI)));
 						UEINTX &= ~(1<<TXINI);
 #ifdef VERBOSE
@@ -288,6 +344,10 @@ static void handleSetupPacket(struct usb_request *rq)
 						switch(rq->bRequest)
 						{
 							case HID_CLSRQ_SET_IDLE:
+								// HID 1.11 : 7.2.4 Set_Idle request. wValue high byte is the duration.
+								if (rq->wIndex < MAX_HID_INTERFACES) {
+									hid_idle[rq->wIndex] = rq->wValue >> 8;
+								}
 								while (!(UEINTX & (1<<TXINI)));
 								UEINTX &= ~(1<<TXINI);
 								break;
@@ -297,7 +357,7 @@ static void handleSetupPacket(struct usb_request *rq)
 								initControlWrite(rq);
 								break;
 							default:
-								printf_P(PSTR("Unhandled class bRequest 0x%02x\r\n"), rq->bRequest);
+								log_event(LOG_USB_UNHANDLED_CLASS_RQ, rq->bRequest);
 								unhandled = 1;
 						}
 						break;
@@ -334,7 +394,7 @@ static void handleSetupPacket(struct usb_request *rq)
 						break;
 					}
 					default:
-						printf_P(PSTR("unhandled endpoint request. rq=%d\r\n"), rq->bRequest);
+						log_event(LOG_USB_UNHANDLED_EP_RQ, rq->bRequest);
 						
 						unhandled = 1;
 						break;						
@@ -420,7 +480,7 @@ static void handleSetupPacket(struct usb_request *rq)
 									}
 									else
 									{
-										printf_P(PSTR("Unknown string id\r\n"));
+										log_event(LOG_USB_UNKNOWN_STRING);
 									}
 								}
 								break;
@@ -508,6 +568,14 @@ static void handleSetupPacket(struct usb_request *rq)
 									}
 								}
 								break;
+							case HID_CLSRQ_GET_IDLE:
+								// HID 1.11 : 7.2.3 Get_Idle request. wIndex is the interface number.
+								if (rq->wIndex >= MAX_HID_INTERFACES) {
+									unhandled = 1;
+									break;
+								}
+								buf2EP(0, &hid_idle[rq->wIndex], 1, rq->wLength, 0);
+								break;
 							default:
 								unhandled = 1;
 						}
@@ -558,14 +626,16 @@ static void handleSetupPacket(struct usb_request *rq)
 	} // IS DEVICE-TO-HOST
 
 	if (unhandled) {
-		printf_P(PSTR("t: %02x, rq: 0x%02x, val: %04x\r\n"), rq->bmRequestType, rq->bRequest, rq->wValue);
+		log_event(LOG_USB_UNHANDLED_RQ, rq->bmRequestType, rq->bRequest, rq->wValue);
 		UECONX |= (1<<STALLRQ);
 	}
 }
 
 static void handleDataPacket(const struct usb_request *rq, uint8_t *dat, uint16_t len)
 {
+#ifdef VERBOSE
 	uint16_t i;
+#endif
 
 	if ((rq->bmRequestType & (USB_RQT_TYPE_MASK)) == USB_RQT_CLASS) {
 
@@ -589,11 +659,13 @@ static void handleDataPacket(const struct usb_request *rq, uint8_t *dat, uint16_
 		}
 	}
 
-	printf_P(PSTR("Unhandled control write [%d] : "), len);
+	log_event(LOG_USB_UNHANDLED_WRITE, len);
+#ifdef VERBOSE
 	for (i=0; i<len; i++) {
 		printf_P(PSTR("%02X "), dat[i]);
 	}
 	printf_P(PSTR("\r\n"));
+#endif
 }
 
 // Device interrupt
@@ -631,14 +703,15 @@ ISR(USB_GEN_vect)
 #endif
 		g_usb_suspend = 0;
 		setupEndpoints();
+		hostReset();
 		UDINT &= ~(1<<EORSTI);
 	}
 
 	if (i & (1<<SOFI)) {
 		UDINT &= ~(1<<SOFI);
-#ifdef VERBOSE
-		printf_P(PSTR("SOFI\r\n"));
-#endif
+		if (g_params->sof) {
+			g_params->sof();
+		}
 	}
 
 	if (i & (1<<EORSMI)) {
@@ -656,7 +729,7 @@ ISR(USB_GEN_vect)
 	}
 }
 
-static void handle_interrupt_xmit(uint8_t ep, void **interrupt_data, volatile int *interrupt_data_len)
+static void handle_interrupt_xmit(uint8_t ep, struct interrupt_ep *iep)
 {
 	uint8_t i;
 
@@ -664,16 +737,18 @@ static void handle_interrupt_xmit(uint8_t ep, void **interrupt_data, volatile in
 	i = UEINTX;
 
 	if (i & (1<<TXINI)) {
-		if (*interrupt_data_len < 0) {
+		if (iep->pending < 0) {
 			// If there's not already data waiting to be
 			// sent, disable the interrupt.
 			UEIENX &= ~(1<<TXINE);
 		} else {
 			UEINTX &= ~(1<<TXINI);
-			buf2EP(ep, (void*)*interrupt_data, *interrupt_data_len, *interrupt_data_len, 0);
-			*interrupt_data = NULL;
-			*interrupt_data_len = -1;
+			buf2EP(ep, iep->buf[iep->pending], iep->len[iep->pending], USB_INTERRUPT_REPORT_MAX, 0);
+			iep->pending = -1;
 			UEINTX &= ~(1<<FIFOCON);
+			if (g_params->interruptLoaded) {
+				g_params->interruptLoaded(ep);
+			}
 		}
 	}
 }
@@ -724,15 +799,15 @@ ISR(USB_COM_vect)
 	}
 
 	if (ueint & (1<<EPINT1)) {
-		handle_interrupt_xmit(1, &interrupt_data, &interrupt_data_len);
+		handle_interrupt_xmit(1, &interrupt_eps[0]);
 	}
 
 	if (ueint & (1<<EPINT2)) {
-		handle_interrupt_xmit(2, &interrupt_data2, &interrupt_data_len2);
+		handle_interrupt_xmit(2, &interrupt_eps[1]);
 	}
 
 	if (ueint & (1<<EPINT3)) {
-		handle_interrupt_xmit(3, &interrupt_data3, &interrupt_data_len3);
+		handle_interrupt_xmit(3, &interrupt_eps[2]);
 	}
 
 #if 0
@@ -743,70 +818,79 @@ ISR(USB_COM_vect)
 #endif
 }
 
-char usb_interruptReady_ep3(void)
-{
-	return interrupt_data_len3 == -1;
-}
-
-void usb_interruptSend_ep3(void *data, int len)
+static void interruptSend(uint8_t ep, const void *data, int len)
 {
+	struct interrupt_ep *iep = &interrupt_eps[ep-1];
 	uint8_t sreg = SREG;
 
-	while (interrupt_data_len3 != -1) { }
+	if (len > USB_INTERRUPT_REPORT_MAX) {
+		len = USB_INTERRUPT_REPORT_MAX;
+	}
 
 	cli();
 
-	interrupt_data3 = data;
-	interrupt_data_len3 = len;
-
-	UENUM = 3;
-	UEIENX |= (1<<TXINE);
+	/* When a bank is free and nothing is queued before this report,
+	 * write it to the endpoint right away. The controller then answers
+	 * the IN token by itself. */
+	UENUM = ep;
+	if (iep->pending < 0 && (UEINTX & (1<<TXINI))) {
+		UEINTX &= ~(1<<TXINI);
+		buf2EP(ep, data, len, USB_INTERRUPT_REPORT_MAX, 0);
+		UEINTX &= ~(1<<FIFOCON);
+		if (g_params->interruptLoaded) {
+			g_params->interruptLoaded(ep);
+		}
+		SREG = sreg;
+		return;
+	}
 
 	SREG = sreg;
-}
-
-char usb_interruptReady_ep2(void)
-{
-	return interrupt_data_len2 == -1;
-}
-
-void usb_interruptSend_ep2(void *data, int len)
-{
-	uint8_t sreg = SREG;
 
-	while (interrupt_data_len2 != -1) { }
+	// Otherwise the interrupt will load the banks as they free up.
+	memcpy(iep->buf[iep->fill], data, len);
+	iep->len[iep->fill] = len;
 
 	cli();
 
-	interrupt_data2 = data;
-	interrupt_data_len2 = len;
+	// The other buffer is either free or holds an older
+	// report which was not sent yet. Either way, it is ours now.
+	iep->pending = iep->fill;
+	iep->fill ^= 1;
 
-	UENUM = 2;
+	UENUM = ep;
 	UEIENX |= (1<<TXINE);
 
 	SREG = sreg;
 }
 
-char usb_interruptReady_ep1(void)
+char usb_interruptReady_ep3(void)
 {
-	return interrupt_data_len == -1;
+	return interrupt_eps[2].pending < 0;
 }
 
-void usb_interruptSend_ep1(void *data, int len)
+void usb_interruptSend_ep3(void *data, int len)
 {
-	uint8_t sreg = SREG;
-
-	while (interrupt_data_len != -1) { }
+	interruptSend(3, data, len);
+}
 
-	cli();
+char usb_interruptReady_ep2(void)
+{
+	return interrupt_eps[1].pending < 0;
+}
 
-	interrupt_data = data;
-	interrupt_data_len = len;
+void usb_interruptSend_ep2(void *data, int len)
+{
+	interruptSend(2, data, len);
+}
 
-	UENUM = 1;
-	UEIENX |= (1<<TXINE);
+char usb_interruptReady_ep1(void)
+{
+	return interrupt_eps[0].pending < 0;
+}
 
-	SREG = sreg;
+void usb_interruptSend_ep1(void *data, int len)
+{
+	interruptSend(1, data, len);
 }
 
 void usb_shutdown(void)
@@ -899,6 +983,8 @@ static void pll_init(void)
 
 void usb_init(const struct usb_parameters *params)
 {
+	uint8_t i;
+
 	// Initialize the registers to the default values
 	// from the datasheet. The bootloader that sometimes
 	// runs before we get here (when doing updates) leaves
@@ -912,6 +998,9 @@ void usb_init(const struct usb_parameters *params)
 	UDADDR = 0x00;
 
 	g_params = params;
+	for (i=0; i<MAX_HID_INTERFACES; i++) {
+		hid_idle[i] = params->hid_params[i].default_idle;
+	}
 
 	// Set some initial values
 	USBCON &= ~(1<<USBE);
@@ -947,5 +1036,8 @@ void usb_init(const struct usb_parameters *params)
 	setupEndpoints();
 
 	UDINT &= ~(1<<SUSPI);
-	UDIEN = (1<<SUSPE) | (1<<EORSTE) |/* (1<<SOFE) |*/ (1<<WAKEUPE) | (1<<EORSME) | (1<<UPRSME);
+	UDIEN = (1<<SUSPE) | (1<<EORSTE) | (1<<WAKEUPE) | (1<<EORSME) | (1<<UPRSME);
+	if (params->sof) {
+		UDIEN |= (1<<SOFE);
+	}
 }
@@ -181,6 +181,10 @@ struct usb_hid_parameters {
 	void *ctx;
 	uint16_t (*getReport)(void *ctx, struct usb_request *rq, const uint8_t **dat);
 	uint8_t (*setReport)(void *ctx, const struct usb_request *rq, const uint8_t *dat, uint16_t len);
+
+	// Idle rate until the host sets one (HID 1.11 7.2.4). 4ms units,
+	// 0 for infinite (reports are only sent when they change).
+	uint8_t default_idle;
 };
 
 struct usb_parameters {
@@ -199,8 +203,27 @@ struct usb_parameters {
 
 	uint8_t n_hid_interfaces;
 	struct usb_hid_parameters hid_params[MAX_HID_INTERFACES];
+
+	// Optional. Called at each start of frame (SOF interrupts are
+	// only enabled when set). Called from interrupt handler.
+	void (*sof)(void);
+
+	// Optional. Called when a report was written to an interrupt IN
+	// endpoint bank. May be called from interrupt handler.
+	void (*interruptLoaded)(uint8_t ep);
+
+	// Optional. Called on bus reset and SET_CONFIGURATION, after the
+	// idle rates are back to their defaults. The host may not have
+	// the current reports anymore. Called from interrupt handler.
+	void (*reconfigured)(void);
 };
 
+/* Largest report usb_interruptSend_epX() accepts (longer ones are
+ * truncated). The data is copied, so the caller may reuse its buffer as
+ * soon as it returns. A report not sent yet is replaced by a newer one.
+ * usb_interruptReady_epX() returns true when no report is waiting. */
+#define USB_INTERRUPT_REPORT_MAX	16
+
 char usb_interruptReady_ep1(void);
 void usb_interruptSend_ep1(void *data, int len);
 char usb_interruptReady_ep2(void);
@@ -208,6 +231,9 @@ void usb_interruptSend_ep2(void *data, int len);
 char usb_interruptReady_ep3(void);
 void usb_interruptSend_ep3(void *data, int len);
 
+/* Current HID idle rate of an interface, in 4ms units. 0: infinite. */
+uint8_t usb_getIdle(uint8_t iface);
+
 void usb_init(const struct usb_parameters *params);
 void usb_doTasks(void);
 void usb_shutdown(void);
@@ -26,6 +26,8 @@
 #include "config.h"
 #include "hid_keycodes.h"
 #include "gc_kb.h"
+#include "calibration.h"
+#include "log.h"
 
 #define STICK_TO_BTN_THRESHOLD	40
 
@@ -78,6 +80,7 @@ void usbpad_init(struct usbpad *pad, uint8_t nsw_mode)
 	memset(pad, 0, sizeof(struct usbpad));
 	buildIdleReport(pad->gamepad_report0);
 	s_nsw_mode = nsw_mode;
+	usbpad_applyConfig();
 }
 
 int usbpad_getReportSize(void)
@@ -171,108 +174,125 @@ static void buildIdleReportKB(unsigned char dstbuf[USBPAD_REPORT_SIZE])
 	dstbuf[2] = HID_KB_NOEVENT;
 }
 
-static void buildReportFromGC(const gc_pad_data *gc_data, unsigned char dstbuf[USBPAD_REPORT_SIZE])
+/* Gamecube to HID value tables, indexed by the raw (8 bit) input.
+ * Generated at compile time by the preprocessor. The HID range is
+ * 0 ... 32000, centered at 16000. */
+#define LUT4(f,i)	f(i), f((i)+1), f((i)+2), f((i)+3)
+#define LUT16(f,i)	LUT4(f,i), LUT4(f,(i)+4), LUT4(f,(i)+8), LUT4(f,(i)+12)
+#define LUT64(f,i)	LUT16(f,i), LUT16(f,(i)+16), LUT16(f,(i)+32), LUT16(f,(i)+48)
+#define LUT256(f)	LUT64(f,0), LUT64(f,64), LUT64(f,128), LUT64(f,192)
+
+/* Force official range (-100 ... +100), then scale to -16000 ... +16000 */
+#define GC_STICK_CLAMP(v)	((v) > 100 ? 100 : (v) < -100 ? -100 : (v))
+#define GC_STICK(i)			(16000 + GC_STICK_CLAMP((i) < 128 ? (i) : (i) - 256) * 160)
+/* Scale 0...255 to 0...16000 */
+#define GC_TRIG(i)			(16000 + ((i) * 63 > 16000 ? 16000 : (i) * 63))
+/* Scale 0...255 to -16000 ... +16000 */
+#define GC_TRIG_FULL(i)		(16000 + ((i) - 127) * 126)
+
+static const int16_t gc_stick_lut[256] PROGMEM = { LUT256(GC_STICK) };
+static const int16_t gc_trig_lut[256] PROGMEM = { LUT256(GC_TRIG) };
+static const int16_t gc_trig_full_lut[256] PROGMEM = { LUT256(GC_TRIG_FULL) };
+
+/* The configuration flags, compiled by usbpad_applyConfig() */
+static struct {
+	void (*build)(const gc_pad_data *gc_data, unsigned char dstbuf[USBPAD_REPORT_SIZE]);
+	const int16_t *trig_lut; // In flash. NULL: Triggers stay centered.
+	uint8_t invert_trigs;
+	uint8_t sliders_as_buttons;
+} gc_cfg;
+
+static void putValue(unsigned char *dst, int16_t value)
 {
-	int16_t xval,yval,cxval,cyval,ltrig,rtrig;
-	uint16_t buttons;
-	uint16_t gcbuttons = gc_data->buttons;
-
-	/* Force official range */
-	xval = minmax(gc_data->x, -100, 100);
-	yval = minmax(gc_data->y, -100, 100);
-	cxval = minmax(gc_data->cx, -100, 100);
-	cyval = minmax(gc_data->cy, -100, 100);
-	ltrig = gc_data->lt;
-	rtrig = gc_data->rt;
-
-	if (g_eeprom_data.cfg.flags & FLAG_SWAP_STICK_AND_DPAD) {
-
-		// Generate new D-Pad button status based on stick
-		gcbuttons &= ~(GC_BTN_DPAD_UP|GC_BTN_DPAD_DOWN|GC_BTN_DPAD_LEFT|GC_BTN_DPAD_RIGHT);
-		if (xval <= -STICK_TO_BTN_THRESHOLD) { gcbuttons |= GC_BTN_DPAD_LEFT; }
-		if (xval >= STICK_TO_BTN_THRESHOLD) { gcbuttons |= GC_BTN_DPAD_RIGHT; }
-		if (yval <= -STICK_TO_BTN_THRESHOLD) { gcbuttons |= GC_BTN_DPAD_DOWN; }
-		if (yval >= STICK_TO_BTN_THRESHOLD) { gcbuttons |= GC_BTN_DPAD_UP; }
-
-		// Generate new stick values based on button (use gc_data here)
-		xval = 0; yval = 0;
-		if (gc_data->buttons & GC_BTN_DPAD_UP) { yval = 100; }
-		if (gc_data->buttons & GC_BTN_DPAD_DOWN) { yval = -100; }
-		if (gc_data->buttons & GC_BTN_DPAD_LEFT) { xval = -100; }
-		if (gc_data->buttons & GC_BTN_DPAD_RIGHT) { xval = 100; }
-	}
-
+	dst[0] = value;
+	dst[1] = value >> 8;
+}
 
-	/* Scale -100 ... + 1000 to -16000 ... +16000 */
-	xval *= 160;
-	yval *= -160;
-	// TODO : Is C-stick different?
-	cxval *= 160;
-	cyval *= -160;
+/* Triggers and buttons, common to both builders */
+static void buildReportFromGC_common(const gc_pad_data *gc_data, uint16_t gcbuttons, unsigned char dstbuf[USBPAD_REPORT_SIZE])
+{
+	int16_t ltrig = 16000, rtrig = 16000;
 
-	if (g_eeprom_data.cfg.flags & FLAG_GC_SLIDERS_AS_BUTTONS) {
+	if (gc_cfg.sliders_as_buttons) {
 		/* In this mode, the sliders control buttons */
-		if (ltrig > 64)
+		if (gc_data->lt > 64)
 			gcbuttons |= GC_BTN_L;
-		if (rtrig > 64)
+		if (gc_data->rt > 64)
 			gcbuttons |= GC_BTN_R;
-
-		/* And the sliders analog values are fixed. */
-		ltrig = rtrig = 0;
 	}
-	else {
-		if (g_eeprom_data.cfg.flags & FLAG_GC_FULL_SLIDERS) {
-			int16_t lts = (int16_t)ltrig - 127;
-			int16_t rts = (int16_t)rtrig - 127;
-			lts *= 126;
-			ltrig = lts;
-			rts *= 126;
-			rtrig = rts;
 
-		} else {
-			/* Scale 0...255 to 0...16000 */
-			ltrig *= 63;
-			if (ltrig > 16000) ltrig=16000;
-			rtrig *= 63;
-			if (rtrig > 16000) rtrig=16000;
-		}
-
-		if (g_eeprom_data.cfg.flags & FLAG_GC_INVERT_TRIGS) {
-			ltrig = -ltrig;
-			rtrig = -rtrig;
+	if (gc_cfg.trig_lut) {
+		ltrig = pgm_read_word(&gc_cfg.trig_lut[gc_data->lt]);
+		rtrig = pgm_read_word(&gc_cfg.trig_lut[gc_data->rt]);
+		if (gc_cfg.invert_trigs) {
+			ltrig = 32000 - ltrig;
+			rtrig = 32000 - rtrig;
 		}
 	}
 
-	if (g_eeprom_data.cfg.flags & FLAG_DISABLE_ANALOG_TRIGGERS) {
-		ltrig = rtrig = 0;
-	}
+	putValue(dstbuf + 9, ltrig);
+	putValue(dstbuf + 11, rtrig);
 
-	/* Unsign for HID report */
-	xval += 16000;
-	yval += 16000;
-	cxval += 16000;
-	cyval += 16000;
-	ltrig += 16000;
-	rtrig += 16000;
+	btnsToReport(mappings_do(MAPPING_GAMECUBE_DEFAULT, gcbuttons), dstbuf+13);
+}
 
-	dstbuf[1] = ((uint8_t*)&xval)[0];
-	dstbuf[2] = ((uint8_t*)&xval)[1];
-	dstbuf[3] = ((uint8_t*)&yval)[0];
-	dstbuf[4] = ((uint8_t*)&yval)[1];
+static void buildReportFromGC(const gc_pad_data *gc_data, unsigned char dstbuf[USBPAD_REPORT_SIZE])
+{
+	/* Y axis are inverted: 32000 - value */
+	putValue(dstbuf + 1, pgm_read_word(&gc_stick_lut[(uint8_t)gc_data->x]));
+	putValue(dstbuf + 3, 32000 - pgm_read_word(&gc_stick_lut[(uint8_t)gc_data->y]));
+	// TODO : Is C-stick different?
+	putValue(dstbuf + 5, pgm_read_word(&gc_stick_lut[(uint8_t)gc_data->cx]));
+	putValue(dstbuf + 7, 32000 - pgm_read_word(&gc_stick_lut[(uint8_t)gc_data->cy]));
 
-	dstbuf[5] = ((uint8_t*)&cxval)[0];
-	dstbuf[6] = ((uint8_t*)&cxval)[1];
-	dstbuf[7] = ((uint8_t*)&cyval)[0];
-	dstbuf[8] = ((uint8_t*)&cyval)[1];
+	buildReportFromGC_common(gc_data, gc_data->buttons, dstbuf);
+}
 
-	dstbuf[9] = ((uint8_t*)&ltrig)[0];
-	dstbuf[10] = ((uint8_t*)&ltrig)[1];
+/* FLAG_SWAP_STICK_AND_DPAD */
+static void buildReportFromGC_swapped(const gc_pad_data *gc_data, unsigned char dstbuf[USBPAD_REPORT_SIZE])
+{
+	int8_t xval, yval;
+	uint16_t gcbuttons = gc_data->buttons;
+
+	// Generate new D-Pad button status based on stick
+	gcbuttons &= ~(GC_BTN_DPAD_UP|GC_BTN_DPAD_DOWN|GC_BTN_DPAD_LEFT|GC_BTN_DPAD_RIGHT);
+	if (gc_data->x <= -STICK_TO_BTN_THRESHOLD) { gcbuttons |= GC_BTN_DPAD_LEFT; }
+	if (gc_data->x >= STICK_TO_BTN_THRESHOLD) { gcbuttons |= GC_BTN_DPAD_RIGHT; }
+	if (gc_data->y <= -STICK_TO_BTN_THRESHOLD) { gcbuttons |= GC_BTN_DPAD_DOWN; }
+	if (gc_data->y >= STICK_TO_BTN_THRESHOLD) { gcbuttons |= GC_BTN_DPAD_UP; }
+
+	// Generate new stick values based on button (use gc_data here)
+	xval = 0; yval = 0;
+	if (gc_data->buttons & GC_BTN_DPAD_UP) { yval = 100; }
+	if (gc_data->buttons & GC_BTN_DPAD_DOWN) { yval = -100; }
+	if (gc_data->buttons & GC_BTN_DPAD_LEFT) { xval = -100; }
+	if (gc_data->buttons & GC_BTN_DPAD_RIGHT) { xval = 100; }
+
+	putValue(dstbuf + 1, pgm_read_word(&gc_stick_lut[(uint8_t)xval]));
+	putValue(dstbuf + 3, 32000 - pgm_read_word(&gc_stick_lut[(uint8_t)yval]));
+	putValue(dstbuf + 5, pgm_read_word(&gc_stick_lut[(uint8_t)gc_data->cx]));
+	putValue(dstbuf + 7, 32000 - pgm_read_word(&gc_stick_lut[(uint8_t)gc_data->cy]));
+
+	buildReportFromGC_common(gc_data, gcbuttons, dstbuf);
+}
 
-	dstbuf[11] = ((uint8_t*)&rtrig)[0];
-	dstbuf[12] = ((uint8_t*)&rtrig)[1];
+void usbpad_applyConfig(void)
+{
+	uint32_t flags = g_eeprom_data.cfg.flags;
+
+	gc_cfg.build = (flags & FLAG_SWAP_STICK_AND_DPAD) ? buildReportFromGC_swapped : buildReportFromGC;
+	gc_cfg.sliders_as_buttons = (flags & FLAG_GC_SLIDERS_AS_BUTTONS) ? 1 : 0;
+	gc_cfg.invert_trigs = (flags & FLAG_GC_INVERT_TRIGS) ? 1 : 0;
 
-	buttons = mappings_do(MAPPING_GAMECUBE_DEFAULT, gcbuttons);
-	btnsToReport(buttons, dstbuf+13);
+	if (flags & (FLAG_GC_SLIDERS_AS_BUTTONS | FLAG_DISABLE_ANALOG_TRIGGERS)) {
+		gc_cfg.trig_lut = NULL;
+	} else if (flags & FLAG_GC_FULL_SLIDERS) {
+		gc_cfg.trig_lut = gc_trig_full_lut;
+	} else {
+		gc_cfg.trig_lut = gc_trig_lut;
+	}
+
+	calibration_build();
 }
 
 #define GC_ANALOG_SAFE_AREA_THRESHOLD 8
@@ -329,9 +349,12 @@ static void buildReportFromGC_NSW(const gc_pad_data *gc_data, unsigned char dstb
 	dstbuf[6] = buildAnalogValueGc2NswHid(-gc_data->cy);
 	dstbuf[7] = 0x00; // dummy
 
-	printf("%4d %4d %4d %4d %4d %4d| %4d %4d %4d %4d\r\n",
+#ifdef DEBUG
+	// Every poll. Floods the UART, keep for debug builds only.
+	log_event(LOG_NSW_GC_REPORT,
 		gc_data->x, gc_data->y, gc_data->cx, gc_data->cy, gc_data->lt, gc_data->rt,
 		dstbuf[3], dstbuf[4], dstbuf[5],dstbuf[6]);
+#endif
 }
 
 
@@ -424,6 +447,9 @@ static void buildReportFromN64_NSW(const n64_pad_data *n64_data, unsigned char d
 
 void usbpad_update(struct usbpad *pad, const gamepad_data *pad_data)
 {
+	n64_pad_data n64;
+	gc_pad_data gc;
+
 	/* Always start with an idle report. Specific report builders can just
 	 * simply ignore unused parts */
 	buildIdleReport(pad->gamepad_report0);
@@ -433,17 +459,21 @@ void usbpad_update(struct usbpad *pad, const gamepad_data *pad_data)
 		switch (pad_data->pad_type)
 		{
 			case PAD_TYPE_N64:
+				n64 = pad_data->n64;
+				calibration_applyN64(&n64);
 				if(s_nsw_mode)
-					buildReportFromN64_NSW(&pad_data->n64, pad->gamepad_report0);
+					buildReportFromN64_NSW(&n64, pad->gamepad_report0);
 				else
-					buildReportFromN64(&pad_data->n64, pad->gamepad_report0);
+					buildReportFromN64(&n64, pad->gamepad_report0);
 				break;
 
 			case PAD_TYPE_GAMECUBE:
+				gc = pad_data->gc;
+				calibration_applyGC(&gc);
 				if(s_nsw_mode)
-					buildReportFromGC_NSW(&pad_data->gc, pad->gamepad_report0);
+					buildReportFromGC_NSW(&gc, pad->gamepad_report0);
 				else
-					buildReportFromGC(&pad_data->gc, pad->gamepad_report0);
+					gc_cfg.build(&gc, pad->gamepad_report0);
 				break;
 
 			default:
@@ -460,7 +490,7 @@ void usbpad_update_kb(struct usbpad *pad, const gamepad_data *pad_data)
 	 * simply ignore unused parts */
 	buildIdleReportKB(pad->gamepad_report0);
 
-	if (pad_data->pad_type == PAD_TYPE_GC_KB) {
+	if (pad_data && pad_data->pad_type == PAD_TYPE_GC_KB) {
 		for (i=0; i<3; i++) {
 			pad->gamepad_report0[i] = gcKeycodeToHID(pad_data->gckb.keys[i]);
 		}
@@ -532,18 +562,18 @@ uint16_t usbpad_hid_get_report(struct usbpad *pad, struct usb_request *rq, const
 					// report_id = rq->wValue & 0xff
 					// interface = rq->wIndex
 					*dat = pad->gamepad_report0;
-					printf_P(PSTR("Get joy report\r\n"));
+					log_event(LOG_HID_GET_JOY);
 					return USBPAD_REPORT_SIZE
 				;
 				} else if (report_id == 2) { // 2 : ES playing
 					pad->hid_report_data[0] = report_id;
 					pad->hid_report_data[1] = 0;
 					pad->hid_report_data[2] = pad->_FFB_effect_index;
-					printf_P(PSTR("ES playing\r\n"));
+					log_event(LOG_HID_ES_PLAYING);
 					*dat = pad->hid_report_data;
 					return 3;
 				} else {
-					printf_P(PSTR("Get input report %d ??\r\n"), rq->wValue & 0xff);
+					log_event(LOG_HID_GET_INPUT_UNKNOWN, rq->wValue & 0xff);
 				}
 			}
 			break;
@@ -555,7 +585,7 @@ uint16_t usbpad_hid_get_report(struct usbpad *pad, struct usb_request *rq, const
 				pad->hid_report_data[2] = 0x1; // (1: success, 2: oom, 3: load error)
 				pad->hid_report_data[3] = 10;
 				pad->hid_report_data[4] = 10;
-				printf_P(PSTR("block load\r\n"));
+				log_event(LOG_HID_BLOCK_LOAD);
 				*dat = pad->hid_report_data;
 				return 5;
 			}
@@ -567,30 +597,30 @@ uint16_t usbpad_hid_get_report(struct usbpad *pad, struct usb_request *rq, const
 				// PID pool move report?
 				pad->hid_report_data[3] = 0xff;
 				pad->hid_report_data[4] = 1;
-				printf_P(PSTR("simultaneous max\r\n"));
+				log_event(LOG_HID_SIMULTANEOUS_MAX);
 				*dat = pad->hid_report_data;
 				return 5;
 			}
 			else if (report_id == REPORT_CREATE_EFFECT) {
 				pad->hid_report_data[0] = report_id;
 				pad->hid_report_data[1] = 1;
-				printf_P(PSTR("create effect\r\n"));
+				log_event(LOG_HID_GET_CREATE_EFFECT);
 				*dat = pad->hid_report_data;
 				return 2;
 			} else {
-				printf_P(PSTR("Unknown feature %d\r\n"), rq->wValue & 0xff);
+				log_event(LOG_HID_GET_FEATURE_UNKNOWN, rq->wValue & 0xff);
 			}
 			break;
 	}
 
-	printf_P(PSTR("Unhandled hid get report type=0x%02x, rq=0x%02x, wVal=0x%04x, wLen=0x%04x\r\n"), rq->bmRequestType, rq->bRequest, rq->wValue, rq->wLength);
+	log_event(LOG_HID_GET_UNHANDLED, rq->bmRequestType, rq->bRequest, rq->wValue, rq->wLength);
 	return 0;
 }
 
 uint8_t usbpad_hid_set_report(struct usbpad *pad, const struct usb_request *rq, const uint8_t *data, uint16_t len)
 {
 	if (len < 1) {
-		printf_P(PSTR("shrt\n"));
+		log_event(LOG_HID_SET_SHORT);
 		return -1;
 	}
 
@@ -599,41 +629,41 @@ uint8_t usbpad_hid_set_report(struct usbpad *pad, const struct usb_request *rq,
 		switch(data[0])
 		{
 			case REPORT_SET_STATUS:
-				printf_P(PSTR("eff. set stat 0x%02x 0x%02x\r\n"),data[1],data[2]);
+				log_event(LOG_FFB_SET_STATUS, data[1], data[2]);
 				break;
 			case REPORT_EFFECT_BLOCK_IDX:
-				printf_P(PSTR("eff. blk. idx %d\r\n"), data[1]);
+				log_event(LOG_FFB_BLOCK_IDX, data[1]);
 				break;
 			case REPORT_DISABLE_ACTUATORS:
-				printf_P(PSTR("disable actuators\r\n"));
+				log_event(LOG_FFB_DISABLE_ACTUATORS);
 				pad->periodic_magnitude = 0;
 				pad->constant_force = 0;
 				pad->vibration_on = 0;
 				break;
 			case REPORT_PID_POOL:
-				printf_P(PSTR("pid pool\r\n"));
+				log_event(LOG_FFB_PID_POOL);
 				break;
 			case REPORT_SET_EFFECT:
 				pad->_FFB_effect_index = data[1];
 				pad->_FFB_effect_duration = data[3] | (data[4]<<8);
-				printf_P(PSTR("set effect %d. duration: %u\r\n"), data[1], pad->_FFB_effect_duration);
+				log_event(LOG_FFB_SET_EFFECT, data[1], pad->_FFB_effect_duration);
 				hexdump(data, len);
 				break;
 			case REPORT_SET_PERIODIC:
 				pad->periodic_magnitude = data[2];
-				printf_P(PSTR("Set periodic - mag: %d, period: %u\r\n"), data[2], data[5] | (data[6]<<8));
+				log_event(LOG_FFB_SET_PERIODIC, data[2], data[5] | (data[6]<<8));
 				hexdump(data, len);
 				break;
 			case REPORT_SET_CONSTANT_FORCE:
 				if (data[1] == 1) {
 					pad->constant_force = data[2];
-					printf_P(PSTR("Constant force %d\r\n"), data[2]);
+					log_event(LOG_FFB_CONSTANT_FORCE, data[2]);
 				}
 				hexdump(data, len);
 				break;
 			case REPORT_EFFECT_OPERATION:
 				if (len != 4) {
-					printf_P(PSTR("Hey!\r\n"));
+					log_event(LOG_FFB_BAD_OP_LENGTH);
 					return -1;
 				}
 				/* Byte 0 : report ID
@@ -642,7 +672,7 @@ uint8_t usbpad_hid_set_report(struct usbpad *pad, const struct usb_request *rq,
 				 * Byte 3 : Loop count */
 
 
-				printf_P(PSTR("EFFECT OP: rom=%s, idx=0x%02x : "), data[1] & 0x80 ? "Yes":"No", data[1] & 0x7F);
+				log_event(LOG_FFB_EFFECT_OP, data[1] >> 7, data[1] & 0x7F);
 
 				// With dolphin, an "infinite" duration is set. The effect is started, then never
 				// stopped. Maybe I misunderstood something? In any case, the following works
@@ -656,7 +686,7 @@ uint8_t usbpad_hid_set_report(struct usbpad *pad, const struct usb_request *rq,
 				} else {
 			 		// main.c uses a 16ms interval timer for vibration "loops"
 					pad->_loop_count = (pad->_FFB_effect_duration / 16) * data[3];
-					printf_P(PSTR("%d loops for %d ms\r\n"), data[3], pad->_loop_count * 16);
+					log_event(LOG_FFB_LOOPS, data[3], pad->_loop_count * 16);
 				}
 
 				switch(data[1] & 0x7F) // Effect block index
@@ -667,21 +697,21 @@ uint8_t usbpad_hid_set_report(struct usbpad *pad, const struct usb_request *rq,
 						switch (data[2]) // effect operation
 						{
 							case EFFECT_OP_START:
-								printf_P(PSTR("Start (lp=%d)\r\n"), pad->_loop_count);
+								log_event(LOG_FFB_START, pad->_loop_count);
 								pad->vibration_on = 1;
 								break;
 
 							case EFFECT_OP_START_SOLO:
-								printf_P(PSTR("Start solo (lp=%d)\r\n"), pad->_loop_count);
+								log_event(LOG_FFB_START_SOLO, pad->_loop_count);
 								pad->vibration_on = 1;
 								break;
 
 							case EFFECT_OP_STOP:
-								printf_P(PSTR("Stop (lp=%d)\r\n"), pad->_loop_count);
+								log_event(LOG_FFB_STOP, pad->_loop_count);
 								pad->vibration_on = 0;
 								break;
 							default:
-								printf_P(PSTR("OP?? %02x (lp=%d)\r\n"), data[2], pad->_loop_count);
+								log_event(LOG_FFB_UNKNOWN_OP, data[2], pad->_loop_count);
 								break;
 						}
 						break;
@@ -697,12 +727,12 @@ uint8_t usbpad_hid_set_report(struct usbpad *pad, const struct usb_request *rq,
 					case 10: // inertia
 					case 11: // friction
 					case 12: // custom force data
-						printf_P(PSTR("Ununsed effect %d\n"), data[1] & 0x7F);
+						log_event(LOG_FFB_UNUSED_EFFECT, data[1] & 0x7F);
 						break;
 				}
 				break;
 			default:
-				printf_P(PSTR("Set output report 0x%02x\r\n"), data[0]);
+				log_event(LOG_HID_SET_OUTPUT_UNKNOWN, data[0]);
 		}
 	}
 	else if ((rq->wValue >> 8) == HID_REPORT_TYPE_FEATURE) {
@@ -710,15 +740,15 @@ uint8_t usbpad_hid_set_report(struct usbpad *pad, const struct usb_request *rq,
 		{
 			case REPORT_CREATE_EFFECT:
 				pad->_FFB_effect_index = data[1];
-				printf_P(PSTR("create effect %d\n"), data[1]);
+				log_event(LOG_HID_SET_CREATE_EFFECT, data[1]);
 				break;
 
 			default:
-				printf_P(PSTR("What?\n"));
+				log_event(LOG_HID_SET_FEATURE_UNKNOWN);
 		}
 	}
 	else {
-		printf_P(PSTR("impossible\n"));
+		log_event(LOG_HID_SET_BAD_TYPE);
 	}
 	return 0;
 }
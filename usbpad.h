@@ -22,6 +22,9 @@ struct usbpad {
 };
 
 void usbpad_init(struct usbpad *pad, uint8_t nsw_mode);
+/* Prepare the report builders for the current configuration flags.
+ * Must be called again when they change. */
+void usbpad_applyConfig(void);
 int usbpad_getReportSize(void);
 unsigned char *usbpad_getReportBuffer(struct usbpad *pad);
 